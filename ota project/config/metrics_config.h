@@ -0,0 +1,25 @@
+#ifndef METRICS_CONFIG_H
+#define METRICS_CONFIG_H
+
+// Prometheus text endpoint: http://<device-ip>:METRICS_PORT/metrics
+#define METRICS_ENABLE        1
+#define METRICS_PORT          9100
+#define METRICS_CTRL_PORT     32770   // provisioning httpd uses the default 32768
+
+// 1: answer only requests that arrived on the STA interface, never on the
+// provisioning SoftAP (there is no auth on these endpoints)
+#define METRICS_STA_ONLY      1
+
+// One scrape socket plus listen + ctrl = 3. The portal's httpd (7 + 2) and
+// DNS already take the lwIP default of 10, so sdkconfig.defaults raises
+// CONFIG_LWIP_MAX_SOCKETS to 16 to leave room for this and the OTA client.
+
+// Whole response is rendered into one static buffer (about 4 KB today);
+// series that don't fit are dropped and counted in ota_metrics_truncated_total
+#define METRICS_BUF_SIZE      5120
+
+// Below the OTA task, so a scrape never delays the download
+#define METRICS_TASK_PRIO     2
+#define METRICS_TASK_STACK    4096
+
+#endif
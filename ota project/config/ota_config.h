@@ -15,4 +15,76 @@ static const char *ROOT_CA_PEM = "-----BEGIN CERTIFICATE-----\n...\n-----END CER
 // Network timeouts
 #define OTA_HTTP_TIMEOUT_MS   30000
 
+// 1: erase each sector just before it is written (no upfront stall)
+// 0: erase the whole image region in esp_ota_begin
+#define OTA_SEQUENTIAL_ERASE  1
+
+// Read back and hash each written sector in a background task; the
+// result must match the streamed SHA-256 before the boot partition moves
+#define OTA_FLASH_VERIFY      1
+
+// Download buffers: preallocated at init, in PSRAM when the board has it.
+// Chunks are whole sectors and divide (or are multiples of) a 16 KB TLS record.
+#define OTA_CHUNK_SIZE        4096
+#define OTA_POOL_BUFFERS      2
+#define OTA_POOL_USE_PSRAM    1
+
+// HTTP request and response head buffers (network/http_client.c); the body
+// is read straight into pool chunks
+#define OTA_HTTP_RX_BUF_SIZE  1024
+#define OTA_HTTP_TX_BUF_SIZE  512
+#define OTA_HTTP_URL_MAX      256       // redirect targets (Location) up to this length
+#define OTA_HTTP_MAX_REDIRECTS  5       // 301/302/303/307/308 followed per request
+#define OTA_DNS_TASK_STACK    3072      // getaddrinfo helper that bounds DNS by the request timeout
+
+// TLS handshake, AES-CTR, SHA-256 and mirror failover all run on this
+// stack. Kept at the original size until the worst path (encrypted image
+// + failover) has been measured; lower it only from mem.stack_free_min.
+#define OTA_TASK_STACK        8192
+
+// Background update checks (ota/ota_scheduler.c)
+#define OTA_SCHED_ENABLE        1
+#define OTA_SCHED_INTERVAL_S    (6 * 3600)
+#define OTA_SCHED_JITTER_PCT    20          // +- around the interval
+#define OTA_SCHED_MIN_DELAY_S   120         // earliest check after boot
+#define OTA_SCHED_RETRY_BASE_S  60          // backoff after failed checks: base * 2^(n-1)
+#define OTA_SCHED_RETRY_MAX_S   (6 * 3600)
+#define OTA_SCHED_SAVE_S        1800        // countdown saved this often; a reboot counts as a full period
+#define OTA_SCHED_TASK_STACK    6144        // TLS handshake
+
+// Speculative manifest fetch on got-IP (ota_update/ota_prefetch.c); with
+// WARM the firmware connection is opened too when an update is due
+#define OTA_PREFETCH_ENABLE       1
+#define OTA_PREFETCH_WARM         1
+#define OTA_PREFETCH_MAX_AGE_MS   30000     // prefetched manifest reused up to this age
+#define OTA_PREFETCH_HOLD_MS      10000     // unadopted warm connection closed after this
+#define OTA_PREFETCH_TASK_STACK   6144
+
+// Firmware mirrors (manifest "mirrors", ota_update/ota_mirrors.c)
+#define OTA_MIRROR_PROBE_MS       1500      // parallel connect probe budget
+#define OTA_MIRROR_RANK_TTL_MS    60000     // probe reused for the same release
+#define OTA_MIRROR_FAILOVERS      4         // reopens per download (Range resume)
+#define OTA_MIRROR_STALL_MS       10000     // read timeout once the body flows
+
+// TLS sessions kept per host in RTC memory (network/tls_session.c), next to
+// the trace ring: about 600 bytes per slot. A session only fits without the
+// peer certificate (CONFIG_MBEDTLS_SSL_KEEP_PEER_CERTIFICATE=n in sdkconfig.defaults).
+#define OTA_TLS_CACHE_SLOTS       3
+#define OTA_TLS_SESSION_MAX       512       // mbedtls_ssl_session_save() output
+#define OTA_TLS_SESSION_TTL_S     (12 * 3600)   // not offered after this; the server may refuse sooner
+
+// Server back-pressure (network/server_backoff.c): wait used for 429/503
+// without a usable Retry-After, and the cap on any requested wait
+#define OTA_BUSY_DEFAULT_S      300
+#define OTA_BUSY_MAX_S          (24 * 3600)
+#define OTA_BUSY_SAVE_S         300         // wait left re-saved this often; a reboot counts as a full period
+
+// Encrypted images (manifest "cipher"): AES-CTR keys are provisioned as
+// 16/32-byte blobs "device" and "fleet" in this NVS namespace
+#define OTA_KEY_NVS_NS        "ota_keys"
+
+// 1: log SHA-256 vs AES-CTR + SHA-256 throughput on a pool chunk at init
+#define OTA_DECRYPT_BENCH     0
+#define OTA_DECRYPT_BENCH_BYTES  (256 * 1024)
+
 #endif
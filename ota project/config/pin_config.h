@@ -4,8 +4,12 @@
 #define I2C_MASTER_NUM        I2C_NUM_0
 #define I2C_MASTER_SDA_IO    21
 #define I2C_MASTER_SCL_IO    22
-#define I2C_MASTER_FREQ_HZ   100000
+#define I2C_MASTER_FREQ_HZ   100000 // 400000 works with most PCF8574 backpacks
 
 #define LCD_I2C_ADDR         0x27   // Change to 0x3F if needed
 
+#define BTN1_PIN             32     // active LOW, internal pull-up
+#define BTN2_PIN             33
+#define BUZZER_PIN           25
+
 #endif
@@ -15,7 +15,30 @@
 // Provisioning timeout (spec says provisioning < 5 minutes) :contentReference[oaicite:2]{index=2}
 #define PROV_TIMEOUT_MS         (5 * 60 * 1000)
 
+// Handoff: after STA gets an IP, keep the portal up this long so the phone
+// can read the result, then drop the AP without restarting the Wi-Fi driver
+#define PROV_HANDOFF_LINGER_MS      5000
+
+// Task stacks (check the mem_monitor log before shrinking)
+#define PROV_DNS_TASK_STACK      4096
+#define PROV_TIMEOUT_TASK_STACK  2048
+#define PROV_RELEASE_TASK_STACK  3072
+
+// Background Wi-Fi scan for the portal's network list
+#define PROV_SCAN_REFRESH_MS        30000   // periodic refresh
+#define PROV_SCAN_MIN_INTERVAL_MS   10000   // /scan?refresh=1 ignored if cache is younger
+#define PROV_SCAN_MAX_AP            16      // cached (deduplicated) networks
+#define PROV_SCAN_DWELL_MS          80      // active dwell per channel
+#define PROV_SCAN_HOME_DWELL_MS     60      // time back on the AP channel between channels
+
 // DNS server port
 #define PROV_DNS_PORT           53
 
+// Captive DNS responder
+#define PROV_DNS_TTL_S          60      // TTL of the wildcard A record and negative answers
+#define PROV_DNS_POLL_MS        200     // select() timeout; bounds shutdown latency
+#define PROV_DNS_RATE_QPS       20      // per-client sustained queries/sec
+#define PROV_DNS_RATE_BURST     40      // per-client burst
+#define PROV_DNS_RATE_CLIENTS   8       // clients tracked (LRU); AP allows PROV_AP_MAX_CONN
+
 #endif
@@ -0,0 +1,19 @@
+#ifndef TRACE_CONFIG_H
+#define TRACE_CONFIG_H
+
+#include "storage/trace_ids.h"
+
+// Categories compiled in; tracepoints of other categories vanish entirely
+#define TRACE_ENABLE_MASK   (TRACE_CAT_SYS | TRACE_CAT_SM | TRACE_CAT_WIFI | TRACE_CAT_HTTP | TRACE_CAT_FLASH)
+
+// Records (16 bytes each, power of two) in RTC slow memory, which is
+// 8 KB on the ESP32 and shared with RTC_DATA_ATTR variables
+#define TRACE_RING_LEN      256
+
+// Print the ring left by the previous boot as hex lines for tools/trace_decode.py
+#define TRACE_DUMP_AT_BOOT  0
+
+// Measure cycles per tracepoint once at init
+#define TRACE_BENCH         0
+
+#endif
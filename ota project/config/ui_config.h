@@ -0,0 +1,19 @@
+#ifndef UI_CONFIG_H
+#define UI_CONFIG_H
+
+// LCD transport: bytes per I2C transaction (4 per character, more on fast bus)
+#define LCD_I2C_BATCH_BYTES   128
+#define LCD_I2C_TIMEOUT_MS    100
+
+// Build lcd_hw_benchmark() and run it once at boot (characters/second)
+#define LCD_I2C_BENCH         0
+
+// UI task: renders posted frames so callers never wait on the display
+#define LCD_UI_TASK_STACK     3072
+#define LCD_UI_TASK_PRIO      2     // below the state machine and OTA task
+#define LCD_UI_TIMED_MAX      4     // queued lcd_show_message_for() messages
+
+// Buzzer patterns waiting behind the one playing
+#define BUZZER_QUEUE_LEN      4
+
+#endif
@@ -0,0 +1,24 @@
+#ifndef WIFI_CONFIG_H
+#define WIFI_CONFIG_H
+
+// Per-network connect timeout (association + DHCP) before trying the next one
+#define WIFI_NET_TIMEOUT_MS         5000
+
+// Max scan results inspected when ranking known networks
+#define WIFI_SCAN_MAX_AP            20
+
+// Scan/connect rounds retried after the first (all networks failed)
+#define WIFI_MAX_RETRY              3
+
+// Exponential backoff between retries: base * 2^(n-1), capped, with jitter
+#define WIFI_BACKOFF_BASE_MS        250
+#define WIFI_BACKOFF_MAX_MS         4000
+
+// Fast reconnect: target the cached BSSID/channel instead of a full scan
+#define WIFI_FAST_CONNECT           1
+
+// Reuse the cached IP/gateway/DNS lease instead of running DHCP.
+// Only safe on networks with long leases or DHCP reservations, so off by default.
+#define WIFI_FAST_REUSE_LEASE       0
+
+#endif
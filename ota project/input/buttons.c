@@ -1,68 +1,100 @@
 #include "buttons.h"
 #include "config/pin_config.h"
-#include "ui/buzzer.h"
-#include "ota/ota_manager.h"
 
 #include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
 #include "esp_timer.h"
 #include <stdbool.h>
-#include <stdio.h>
 
 #define DEBOUNCE_MS     50
 #define LONG_PRESS_MS   5000
 
-static bool timer_running = false;
-static int64_t press_start_time = 0;
+#define BUTTON_COUNT    2
 
-static bool read_button(gpio_num_t pin) {
-    static int64_t last_change_time[40] = {0};
-    static bool last_state[40] = {false};
+ESP_EVENT_DEFINE_BASE(BUTTON_EVENT);
 
-    bool current = (gpio_get_level(pin) == 0); // active LOW
+static const char *TAG = "buttons";
 
-    if (current != last_state[pin]) {
-        last_state[pin] = current;
-        last_change_time[pin] = esp_timer_get_time();
-    }
+typedef struct {
+    gpio_num_t pin;
+    bool pressed;                   // debounced state
+    esp_timer_handle_t debounce;
+} button_t;
+
+// Debounced state only changes in esp_timer callbacks, which all run in
+// the esp_timer task, so no locking is needed
+static button_t buttons[BUTTON_COUNT] = {
+    { .pin = BTN1_PIN },
+    { .pin = BTN2_PIN },
+};
+static esp_timer_handle_t combo_timer = NULL;
+
+// Every edge restarts the quiet period; the timer only fires once the
+// contacts have settled
+static void IRAM_ATTR button_isr(void *arg) {
+    button_t *b = (button_t *)arg;
+    esp_timer_stop(b->debounce);
+    esp_timer_start_once(b->debounce, DEBOUNCE_MS * 1000);
+}
 
-    if ((esp_timer_get_time() - last_change_time[pin]) >
-        (DEBOUNCE_MS * 1000)) {
-        return current;
+static void combo_cb(void *arg) {
+    ESP_LOGI(TAG, "OTA combo held");
+    esp_event_post(BUTTON_EVENT, BUTTON_EVENT_OTA_COMBO, NULL, 0, 0);
+}
+
+static void debounce_cb(void *arg) {
+    button_t *b = (button_t *)arg;
+    bool pressed = (gpio_get_level(b->pin) == 0); // active LOW
+
+    if (pressed == b->pressed) {
+        return;     // bounced back to where it was
     }
+    b->pressed = pressed;
+
+    int idx = (int)(b - buttons);
+    esp_event_post(BUTTON_EVENT, pressed ? BUTTON_EVENT_PRESSED : BUTTON_EVENT_RELEASED,
+                   &idx, sizeof(idx), 0);
 
-    return false;
+    // Long press: armed when the second button goes down, fires once per hold
+    if (buttons[0].pressed && buttons[1].pressed) {
+        esp_timer_start_once(combo_timer, (uint64_t)LONG_PRESS_MS * 1000);
+    } else {
+        esp_timer_stop(combo_timer);
+    }
 }
 
 void buttons_init(void) {
     gpio_config_t cfg = {
         .pin_bit_mask = (1ULL << BTN1_PIN) | (1ULL << BTN2_PIN),
         .mode = GPIO_MODE_INPUT,
-        .pull_up_en = GPIO_PULLUP_ENABLE
+        .pull_up_en = GPIO_PULLUP_ENABLE,
+        .intr_type = GPIO_INTR_ANYEDGE
     };
     gpio_config(&cfg);
-}
-
-void buttons_process(void) {
-    bool btn1 = read_button(BTN1_PIN);
-    bool btn2 = read_button(BTN2_PIN);
 
-    if (btn1 && btn2) {
-        if (!timer_running) {
-            press_start_time = esp_timer_get_time();
-            timer_running = true;
-        }
-
-        if ((esp_timer_get_time() - press_start_time) >=
-            (LONG_PRESS_MS * 1000)) {
+    const esp_timer_create_args_t combo_args = {
+        .callback = combo_cb,
+        .name = "btn_combo"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&combo_args, &combo_timer));
 
-            printf("[INPUT] OTA Trigger Detected\n");
+    // Already installed is fine (another driver may share the service)
+    esp_err_t err = gpio_install_isr_service(0);
+    if (err != ESP_OK && err != ESP_ERR_INVALID_STATE) {
+        ESP_LOGE(TAG, "ISR service: %s", esp_err_to_name(err));
+        return;
+    }
 
-            buzzer_beep(2);
-            ota_set_state(OTA_STATE_CHECKING_WIFI);
+    for (int i = 0; i < BUTTON_COUNT; i++) {
+        const esp_timer_create_args_t args = {
+            .callback = debounce_cb,
+            .arg = &buttons[i],
+            .name = "btn_debounce"
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&args, &buttons[i].debounce));
 
-            timer_running = false;
-        }
-    } else {
-        timer_running = false;
+        buttons[i].pressed = (gpio_get_level(buttons[i].pin) == 0);
+        gpio_isr_handler_add(buttons[i].pin, button_isr, &buttons[i]);
     }
 }
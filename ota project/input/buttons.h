@@ -1,7 +1,19 @@
 #ifndef BUTTONS_H
 #define BUTTONS_H
 
+#include "esp_event.h"
+
+ESP_EVENT_DECLARE_BASE(BUTTON_EVENT);
+
+// Posted to the default event loop. PRESSED/RELEASED carry the button
+// index (int, 0 = BTN1) as event data.
+typedef enum {
+    BUTTON_EVENT_PRESSED,
+    BUTTON_EVENT_RELEASED,
+    BUTTON_EVENT_OTA_COMBO,     // both buttons held for LONG_PRESS_MS
+} button_event_t;
+
+// Needs the default event loop (created by wifi_manager_init)
 void buttons_init(void);
-void buttons_process(void);
 
 #endif
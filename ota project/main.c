@@ -1,17 +1,54 @@
 #include <stdio.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "esp_log.h"
 
 #include "ui/lcd_ui.h"
+#include "ui/buzzer.h"
+#include "input/buttons.h"
 #include "network/wifi_manager.h"
+#include "network/server_backoff.h"
+#include "network/tls_session.h"
+#include "network/metrics_server.h"
 #include "ota/ota_manager.h"
 #include "ota/ota_state_machine.h"
+#include "ota/ota_scheduler.h"
 #include "ota_update/ota_update_manager.h"
+#include "ota_update/ota_prefetch.h"
 
 #include "storage/ota_diag.h"
+#include "storage/mem_monitor.h"
+#include "storage/trace.h"
+
+static const char *TAG = "MAIN";
+
+static void on_button_event(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    // Restarting from CHECKING_WIFI mid-download would strand the running
+    // update; during setup or a connect the session is already on its way
+    ota_state_t st = ota_get_state();
+    if (st == OTA_STATE_PROVISIONING || st == OTA_STATE_CONNECTING)
+    {
+        ESP_LOGI(TAG, "OTA trigger ignored, WiFi setup in progress");
+        return;
+    }
+    if (ota_update_is_running() ||
+        (st >= OTA_STATE_FETCHING_MANIFEST && st <= OTA_STATE_INSTALLING))
+    {
+        ESP_LOGI(TAG, "OTA trigger ignored, update in progress");
+        return;
+    }
+
+    ESP_LOGI(TAG, "OTA trigger detected");
+    buzzer_beep(2);
+    ota_set_state(OTA_STATE_CHECKING_WIFI);
+}
 
 void app_main(void)
 {
+    trace_init();
+    mem_monitor_init();
+    mem_monitor_task_enter(0);  // main task, size set by sdkconfig
     ota_diag_init();
     ota_diag_boot_check_and_update();
 
@@ -19,27 +56,37 @@ void app_main(void)
     wifi_manager_init();
     ota_init();
     ota_update_init();
+    tls_session_init();
+    server_backoff_init();
+    ota_prefetch_init();
+    ota_scheduler_init();
+    metrics_server_start();
+
+    buzzer_init();
+    buttons_init();
+    esp_event_handler_register(BUTTON_EVENT, BUTTON_EVENT_OTA_COMBO, on_button_event, NULL);
 
-    // Show last OTA result briefly
+    // Show last OTA result briefly; the state machine starts meanwhile
     ota_diag_record_t rec;
     if (ota_diag_get_last(&rec))
     {
         char msg[21];
         snprintf(msg, sizeof(msg), "Last: %s", ota_diag_status_str(rec.last_status));
-        lcd_show_message(msg);
-        vTaskDelay(pdMS_TO_TICKS(1200));
+        lcd_show_message_for(msg, 1200);
 
         if (rec.last_status == OTA_DIAG_STATUS_FAILED)
         {
             snprintf(msg, sizeof(msg), "Err: %s", ota_diag_error_short_str(rec.last_error));
-            lcd_show_message(msg);
-            vTaskDelay(pdMS_TO_TICKS(1200));
+            lcd_show_message_for(msg, 1200);
         }
     }
 
     while (1)
     {
         ota_state_machine_process();
+        ota_scheduler_process();
+        server_backoff_process();
+        trace_tick();
         vTaskDelay(pdMS_TO_TICKS(300));
     }
 }
@@ -1,17 +1,15 @@
 #include "manifest_client.h"
 #include "config/ota_config.h"
+#include "network/server_backoff.h"
+#include "network/tls_session.h"
 
-#include "esp_http_client.h"
 #include "esp_log.h"
+#include "esp_mac.h"
 #include <string.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <ctype.h>
 
-#if OTA_USE_CRT_BUNDLE
-#include "esp_crt_bundle.h"
-#endif
-
 static const char *TAG = "MANIFEST";
 
 static bool json_extract_string(const char *json, const char *key, char *out, size_t out_sz)
@@ -43,6 +41,47 @@ static bool json_extract_string(const char *json, const char *key, char *out, si
     return true;
 }
 
+// "key": ["a", "b"] into consecutive out_sz-byte slots; returns the count
+static size_t json_extract_string_array(const char *json, const char *key, char *out, size_t max, size_t out_sz)
+{
+    if (!json || !key || !out || out_sz == 0) return 0;
+
+    char pattern[64];
+    snprintf(pattern, sizeof(pattern), "\"%s\"", key);
+
+    const char *p = strstr(json, pattern);
+    if (!p) return 0;
+
+    p = strchr(p, ':');
+    if (!p) return 0;
+    p++;
+
+    while (*p && isspace((unsigned char)*p)) p++;
+    if (*p != '[') return 0;
+    p++;
+
+    size_t count = 0;
+    while (count < max)
+    {
+        while (*p && (isspace((unsigned char)*p) || *p == ',')) p++;
+        if (*p != '\"') break;
+        p++;
+
+        const char *end = strchr(p, '\"');
+        if (!end) break;
+
+        size_t n = (size_t)(end - p);
+        if (n >= out_sz) n = out_sz - 1;
+
+        char *dst = out + count * out_sz;
+        memcpy(dst, p, n);
+        dst[n] = '\0';
+        count++;
+        p = end + 1;
+    }
+    return count;
+}
+
 static bool json_extract_size_t(const char *json, const char *key, size_t *out_val)
 {
     if (!json || !key || !out_val) return false;
@@ -70,42 +109,31 @@ static bool json_extract_size_t(const char *json, const char *key, size_t *out_v
 
 static esp_err_t fetch_text_https(const char *url, char *buf, size_t buf_sz)
 {
-    esp_http_client_config_t cfg = {
-        .url = url,
-        .timeout_ms = OTA_HTTP_TIMEOUT_MS,
-#if OTA_USE_CRT_BUNDLE
-        .crt_bundle_attach = esp_crt_bundle_attach,
-#else
-        .cert_pem = ROOT_CA_PEM,
-#endif
-    };
-
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
+    tls_reply_t reply;
+    tls_conn_t *client = tls_session_get(url, 0, OTA_HTTP_TIMEOUT_MS, &reply);
     if (!client) return ESP_FAIL;
 
-    esp_err_t err = esp_http_client_perform(client);
-    if (err != ESP_OK)
-    {
-        esp_http_client_cleanup(client);
-        return err;
-    }
-
-    int status = esp_http_client_get_status_code(client);
+    int status = reply.status;
     if (status != 200)
     {
-        esp_http_client_cleanup(client);
-        return ESP_FAIL;
+        esp_err_t err = server_backoff_note(status, &reply.server) ? ESP_ERR_INVALID_STATE : ESP_FAIL;
+        ESP_LOGE(TAG, "HTTP status %d", status);
+        tls_session_release(client);
+        return err;
     }
+    server_backoff_note(status, &reply.server);
 
-    int r = esp_http_client_read(client, buf, (int)buf_sz - 1);
-    if (r < 0)
+    size_t r = 0;
+    int n = 0;
+    while (r < buf_sz - 1 && (n = tls_session_read(client, buf + r, buf_sz - 1 - r)) > 0) r += (size_t)n;
+    if (n < 0)
     {
-        esp_http_client_cleanup(client);
+        tls_session_release(client);
         return ESP_FAIL;
     }
     buf[r] = '\0';
 
-    esp_http_client_cleanup(client);
+    tls_session_release(client);
     return ESP_OK;
 }
 
@@ -115,11 +143,20 @@ bool manifest_fetch(ota_manifest_t *m, char *err_msg, size_t err_sz)
     memset(m, 0, sizeof(*m));
     if (err_msg && err_sz) err_msg[0] = '\0';
 
-    char json[1400] = {0};
+    uint32_t wait_s = server_backoff_remaining_s();
+    if (wait_s > 0)
+    {
+        if (err_msg) snprintf(err_msg, err_sz, "server busy, retry in %lus", (unsigned long)wait_s);
+        ESP_LOGW(TAG, "not fetching, server asked to wait %lu s", (unsigned long)wait_s);
+        return false;
+    }
+
+    char json[2048] = {0};
     esp_err_t err = fetch_text_https(OTA_MANIFEST_URL, json, sizeof(json));
     if (err != ESP_OK)
     {
-        if (err_msg) snprintf(err_msg, err_sz, "manifest fetch failed");
+        if (err_msg && err == ESP_ERR_INVALID_STATE) snprintf(err_msg, err_sz, "server busy");
+        else if (err_msg) snprintf(err_msg, err_sz, "manifest fetch failed");
         ESP_LOGE(TAG, "fetch failed: %d", (int)err);
         return false;
     }
@@ -134,9 +171,37 @@ bool manifest_fetch(ota_manifest_t *m, char *err_msg, size_t err_sz)
         return false;
     }
 
+    // Mirrors are optional; "url" stays the primary
+    m->mirror_count = (uint8_t)json_extract_string_array(json, "mirrors", &m->mirrors[0][0],
+                                                         MANIFEST_MAX_MIRRORS, sizeof(m->mirrors[0]));
+
     // release_notes is optional
     json_extract_string(json, "release_notes", m->release_notes, sizeof(m->release_notes));
 
+    // Encrypted image: cipher, key and IV are checked when decryption starts
+    if (json_extract_string(json, "cipher", m->cipher, sizeof(m->cipher)) &&
+        strcmp(m->cipher, "none") != 0)
+    {
+        json_extract_string(json, "key_id", m->key_id, sizeof(m->key_id));
+
+        // One byte larger than m->iv, so an overlong value fails the length check
+        char iv[sizeof(m->iv) + 1];
+        if (!json_extract_string(json, "iv", iv, sizeof(iv)) || strlen(iv) != 32)
+        {
+            if (err_msg) snprintf(err_msg, err_sz, "invalid iv");
+            ESP_LOGE(TAG, "iv missing or not 32 hex chars");
+            return false;
+        }
+        memcpy(m->iv, iv, sizeof(m->iv));
+    }
+
+    // Rollout wave; absent = everyone
+    size_t pct = 100;
+    json_extract_size_t(json, "rollout_pct", &pct);
+    m->rollout_pct = (uint8_t)(pct > 100 ? 100 : pct);
+    if (!json_extract_string(json, "rollout_seed", m->rollout_seed, sizeof(m->rollout_seed)))
+        snprintf(m->rollout_seed, sizeof(m->rollout_seed), "%s", m->version);
+
     // Basic sha length check
     if (strlen(m->sha256) != 64)
     {
@@ -145,6 +210,33 @@ bool manifest_fetch(ota_manifest_t *m, char *err_msg, size_t err_sz)
         return false;
     }
 
-    ESP_LOGI(TAG, "Manifest: ver=%s size=%u url=%s", m->version, (unsigned)m->size_bytes, m->url);
+    ESP_LOGI(TAG, "Manifest: ver=%s size=%u url=%s (+%u mirrors)%s%s rollout=%u%%", m->version, (unsigned)m->size_bytes, m->url,
+             m->mirror_count, m->cipher[0] ? " cipher=" : "", m->cipher, m->rollout_pct);
     return true;
 }
+
+uint8_t manifest_rollout_bucket(const ota_manifest_t *m)
+{
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    // FNV-1a over MAC + seed: stable for a release, reshuffled by the next
+    uint32_t h = 2166136261u;
+    for (int i = 0; i < 6; i++)
+    {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    for (const char *p = m ? m->rollout_seed : ""; *p; p++)
+    {
+        h ^= (uint8_t)*p;
+        h *= 16777619u;
+    }
+    return (uint8_t)(h % 100);
+}
+
+bool manifest_in_rollout(const ota_manifest_t *m)
+{
+    if (!m || m->rollout_pct >= 100) return true;
+    return manifest_rollout_bucket(m) < m->rollout_pct;
+}
@@ -3,16 +3,31 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
+
+#define MANIFEST_MAX_MIRRORS  3
 
 typedef struct {
     char version[32];
     char url[256];
-    char sha256[65];          // hex string (64 chars + null)
+    char mirrors[MANIFEST_MAX_MIRRORS][256];  // same image on other hosts (optional)
+    uint8_t mirror_count;
+    char sha256[65];          // hex string (64 chars + null), of the plaintext image
     size_t size_bytes;
+    char cipher[16];          // "" = plain, else "aes-128-ctr" / "aes-256-ctr"
+    char key_id[8];           // "device" or "fleet" (default)
+    char iv[33];              // hex, initial CTR counter block
+    uint8_t rollout_pct;      // 0..100, share of devices in the current wave (default 100)
+    char rollout_seed[32];    // reshuffles buckets per release (default: version)
     char release_notes[256];
 } ota_manifest_t;
 
-// Fetches and parses OTA manifest from OTA_MANIFEST_URL
+// Fetches and parses OTA manifest from OTA_MANIFEST_URL.
+// Nothing is sent while the server's Retry-After wait is running.
 bool manifest_fetch(ota_manifest_t *out_manifest, char *err_msg, size_t err_sz);
 
+// This device's rollout bucket 0..99 (MAC + seed) and whether it is in the wave
+uint8_t manifest_rollout_bucket(const ota_manifest_t *m);
+bool manifest_in_rollout(const ota_manifest_t *m);
+
 #endif
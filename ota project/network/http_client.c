@@ -0,0 +1,245 @@
+#include "http_client.h"
+
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define USER_AGENT      "ESP32 HTTP Client/1.0"     // as esp_http_client sent it
+
+bool http_parse_url(const char *url, http_url_t *u)
+{
+    u->tls = strncmp(url, "https://", 8) == 0;
+    if (!u->tls && strncmp(url, "http://", 7) != 0) return false;
+    const char *p = url + (u->tls ? 8 : 7);
+
+    size_t n = strcspn(p, ":/?");
+    if (n == 0 || n >= sizeof(u->host)) return false;
+    memcpy(u->host, p, n);
+    u->host[n] = '\0';
+    p += n;
+
+    if (*p == ':')
+    {
+        size_t k = strspn(p + 1, "0123456789");
+        if (k == 0 || k >= sizeof(u->port)) return false;
+        memcpy(u->port, p + 1, k);
+        u->port[k] = '\0';
+        p += 1 + k;
+    }
+    else
+    {
+        snprintf(u->port, sizeof(u->port), "%s", u->tls ? "443" : "80");
+    }
+    u->path = p;
+    return true;
+}
+
+bool http_is_redirect(const http_reply_t *reply)
+{
+    int st = reply->status;
+    return (st == 301 || st == 302 || st == 303 || st == 307 || st == 308) && reply->location[0];
+}
+
+bool http_resolve_location(const http_url_t *base, const char *loc, char *out, size_t sz)
+{
+    const char *scheme = base->tls ? "https:" : "http:";
+    int n;
+
+    if (strncmp(loc, "https://", 8) == 0 || strncmp(loc, "http://", 7) == 0)
+    {
+        n = snprintf(out, sz, "%s", loc);
+    }
+    else if (loc[0] == '/' && loc[1] == '/')
+    {
+        n = snprintf(out, sz, "%s%s", scheme, loc);
+    }
+    else
+    {
+        bool default_port = strcmp(base->port, base->tls ? "443" : "80") == 0;
+        n = snprintf(out, sz, "%s//%s%s%s", scheme, base->host,
+                     default_port ? "" : ":", default_port ? "" : base->port);
+        if (n < 0 || (size_t)n >= sz) return false;
+
+        if (loc[0] != '/')
+        {
+            // Relative to the base path's directory, query dropped
+            size_t dir = strcspn(base->path, "?");
+            while (dir > 0 && base->path[dir - 1] != '/') dir--;
+            n += snprintf(out + n, sz - n, "%s%.*s", dir ? "" : "/", (int)dir, base->path);
+            if ((size_t)n >= sz) return false;
+        }
+        n += snprintf(out + n, sz - n, "%s", loc);
+    }
+    return n > 0 && (size_t)n < sz;
+}
+
+void http_stream_init(http_stream_t *h, http_recv_fn recv, http_send_fn send, void *ctx)
+{
+    memset(h, 0, sizeof(*h));
+    h->recv = recv;
+    h->send = send;
+    h->ctx = ctx;
+    h->left = -1;
+}
+
+static int stream_read(http_stream_t *h, void *buf, size_t len)
+{
+    if (h->head_pos < h->head_len)
+    {
+        size_t n = h->head_len - h->head_pos;
+        if (n > len) n = len;
+        memcpy(buf, h->head + h->head_pos, n);
+        h->head_pos += n;
+        return (int)n;
+    }
+    return h->recv(h->ctx, buf, len);
+}
+
+// One CRLF-terminated line; overlong lines are cut
+static bool read_line(http_stream_t *h, char *line, size_t sz)
+{
+    size_t n = 0;
+    for (;;)
+    {
+        char ch;
+        if (stream_read(h, &ch, 1) != 1) return false;
+        if (ch == '\n') break;
+        if (ch != '\r' && n < sz - 1) line[n++] = ch;
+    }
+    line[n] = '\0';
+    return true;
+}
+
+bool http_send_get(http_stream_t *h, const http_url_t *u, size_t offset)
+{
+    bool default_port = strcmp(u->port, u->tls ? "443" : "80") == 0;
+    char req[OTA_HTTP_TX_BUF_SIZE];
+    int n = snprintf(req, sizeof(req),
+                     "GET %s%s HTTP/1.1\r\n"
+                     "Host: %s%s%s\r\n"
+                     "User-Agent: " USER_AGENT "\r\n"
+                     "Connection: close\r\n",
+                     u->path[0] == '/' ? "" : "/", u->path,
+                     u->host, default_port ? "" : ":", default_port ? "" : u->port);
+    if (offset > 0 && n > 0 && (size_t)n < sizeof(req))
+        n += snprintf(req + n, sizeof(req) - n, "Range: bytes=%u-\r\n", (unsigned)offset);
+    if (n > 0 && (size_t)n < sizeof(req)) n += snprintf(req + n, sizeof(req) - n, "\r\n");
+    if (n <= 0 || (size_t)n >= sizeof(req)) return false;
+
+    return h->send(h->ctx, req, (size_t)n) == 0;
+}
+
+static void on_header(http_stream_t *h, http_reply_t *reply, const char *k, const char *v)
+{
+    if (strcasecmp(k, "Content-Length") == 0)
+    {
+        reply->content_length = strtoll(v, NULL, 10);
+        if (!h->chunked) h->left = reply->content_length;
+    }
+    else if (strcasecmp(k, "Transfer-Encoding") == 0 && strncasecmp(v, "chunked", 7) == 0)
+    {
+        h->chunked = true;
+        h->left = -1;
+    }
+    else if (strcasecmp(k, "Retry-After") == 0)
+    {
+        snprintf(reply->server.retry_after, sizeof(reply->server.retry_after), "%s", v);
+    }
+    else if (strcasecmp(k, "Content-Range") == 0)
+    {
+        snprintf(reply->content_range, sizeof(reply->content_range), "%s", v);
+    }
+    else if (strcasecmp(k, "Location") == 0)
+    {
+        // Too long to keep whole: dropped, so the redirect isn't followed to a cut URL
+        if (strlen(v) < sizeof(reply->location)) snprintf(reply->location, sizeof(reply->location), "%s", v);
+    }
+}
+
+bool http_read_head(http_stream_t *h, http_reply_t *reply)
+{
+    memset(reply, 0, sizeof(*reply));
+    reply->content_length = -1;
+
+    size_t len = 0;
+    char *end = NULL;
+    while (!end)
+    {
+        if (len >= sizeof(h->head) - 1) return false;
+        int n = h->recv(h->ctx, h->head + len, sizeof(h->head) - 1 - len);
+        if (n <= 0) return false;
+        len += (size_t)n;
+        h->head[len] = '\0';
+        end = strstr(h->head, "\r\n\r\n");
+    }
+    h->head_pos = (size_t)(end - h->head) + 4;
+    h->head_len = len;
+    *end = '\0';
+
+    if (sscanf(h->head, "HTTP/%*d.%*d %d", &reply->status) != 1) return false;
+    h->left = -1;
+
+    for (char *line = strstr(h->head, "\r\n"); line; )
+    {
+        line += 2;
+        char *next = strstr(line, "\r\n");
+        if (next) *next = '\0';
+
+        char *colon = strchr(line, ':');
+        if (colon)
+        {
+            *colon = '\0';
+            char *v = colon + 1;
+            while (*v == ' ' || *v == '\t') v++;
+            on_header(h, reply, line, v);
+        }
+        line = next;
+    }
+
+    if (reply->status == 204 || reply->status == 304) h->eof = true;
+    return true;
+}
+
+int http_read_body(http_stream_t *h, void *buf, size_t len)
+{
+    if (h->eof || len == 0) return 0;
+
+    if (h->chunked && h->chunk_left == 0)
+    {
+        char line[24];
+        if (h->chunk_seen && !read_line(h, line, sizeof(line))) return -1;   // CRLF closing the last chunk
+        if (!read_line(h, line, sizeof(line))) return -1;
+
+        char *end;
+        h->chunk_left = strtoul(line, &end, 16);
+        if (end == line) return -1;
+        h->chunk_seen = true;
+        if (h->chunk_left == 0)
+        {
+            h->eof = true;          // trailers stay unread; the connection is closed anyway
+            return 0;
+        }
+    }
+
+    size_t want = len;
+    if (h->chunked && want > h->chunk_left) want = h->chunk_left;
+    if (!h->chunked && h->left >= 0 && (int64_t)want > h->left) want = (size_t)h->left;
+    if (want == 0)
+    {
+        h->eof = true;
+        return 0;
+    }
+
+    int n = stream_read(h, buf, want);
+    if (n == 0 && !h->chunked && h->left < 0)
+    {
+        h->eof = true;              // body delimited by the server closing
+        return 0;
+    }
+    if (n <= 0) return -1;
+
+    if (h->chunked) h->chunk_left -= (size_t)n;
+    else if (h->left > 0) h->left -= n;
+    return n;
+}
@@ -0,0 +1,75 @@
+#ifndef HTTP_CLIENT_H
+#define HTTP_CLIENT_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "config/ota_config.h"
+#include "server_backoff.h"
+
+// HTTP/1.1 GET over a byte stream (TLS or plain TCP, see tls_session.c),
+// kept free of ESP-IDF/lwIP so the host test (tools/http_client_test.c)
+// can drive it directly.
+
+typedef struct {
+    bool tls;
+    char host[64];
+    char port[8];
+    const char *path;           // into the URL: "" or starting with '/' or '?'
+} http_url_t;
+
+// Response head
+typedef struct {
+    int status;
+    int64_t content_length;     // -1: not given
+    server_reply_t server;      // for server_backoff_note
+    char content_range[48];
+    char location[OTA_HTTP_URL_MAX];    // redirect target as sent, "" = none
+} http_reply_t;
+
+// Transport: recv > 0 bytes, 0 closed, < 0 error or timeout;
+// send 0 once everything is written, < 0 error
+typedef int (*http_recv_fn)(void *ctx, void *buf, size_t len);
+typedef int (*http_send_fn)(void *ctx, const void *buf, size_t len);
+
+typedef struct {
+    http_recv_fn recv;
+    http_send_fn send;
+    void *ctx;
+
+    // Response head; body bytes read along with it are served from here first
+    char head[OTA_HTTP_RX_BUF_SIZE];
+    size_t head_pos, head_len;
+
+    int64_t left;               // Content-Length still unread, -1 = until close
+    bool chunked;
+    bool chunk_seen;
+    size_t chunk_left;
+    bool eof;
+} http_stream_t;
+
+// http:// and https:// only; default ports 80 and 443
+bool http_parse_url(const char *url, http_url_t *u);
+
+// 301/302/303/307/308 with a Location to follow
+bool http_is_redirect(const http_reply_t *reply);
+
+// Absolute URL for a Location received on base: absolute, "//host/..",
+// "/path" and path-relative forms. False if it doesn't fit out.
+bool http_resolve_location(const http_url_t *base, const char *loc, char *out, size_t sz);
+
+void http_stream_init(http_stream_t *h, http_recv_fn recv, http_send_fn send, void *ctx);
+
+// GET u->path, from offset ("Range: bytes=<offset>-") when offset > 0.
+// False if the request doesn't fit OTA_HTTP_TX_BUF_SIZE or can't be sent.
+bool http_send_get(http_stream_t *h, const http_url_t *u, size_t offset);
+
+// False on a malformed head, one bigger than OTA_HTTP_RX_BUF_SIZE, or a
+// connection that ended before it
+bool http_read_head(http_stream_t *h, http_reply_t *reply);
+
+// Body bytes, chunked coding removed: > 0 read, 0 at the end of the body,
+// < 0 error, timeout or connection closed early
+int http_read_body(http_stream_t *h, void *buf, size_t len);
+
+#endif
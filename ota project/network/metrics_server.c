@@ -0,0 +1,263 @@
+#include "metrics_server.h"
+#include "config/metrics_config.h"
+#include "wifi_manager.h"
+#include "server_backoff.h"
+#include "tls_session.h"
+#include "ota/ota_manager.h"
+#include "ota/ota_state_machine.h"
+#include "ota/ota_scheduler.h"
+#include "ota_update/ota_update_manager.h"
+#include "storage/ota_diag.h"
+#include "storage/nvs_stats.h"
+#include "storage/trace.h"
+
+#include "esp_http_server.h"
+#include "esp_netif.h"
+#include "lwip/sockets.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+static const char *TAG = "metrics";
+
+static httpd_handle_t g_http = NULL;
+
+// Only the httpd task renders, one request at a time
+static char g_buf[METRICS_BUF_SIZE];
+static uint32_t g_scrapes = 0;
+static uint32_t g_truncated = 0;
+
+// Read once at start: scrapes never open NVS
+static ota_diag_record_t g_diag;
+static bool g_diag_valid = false;
+
+/* ---------- Rendering ---------- */
+
+typedef struct {
+    char *p;
+    size_t cap;
+    size_t len;
+    bool full;      // later output dropped so no line is ever cut
+} out_t;
+
+// Integer formats only: newlib prints them without touching the heap
+static void put(out_t *o, const char *fmt, ...)
+{
+    if (o->full) return;
+
+    va_list ap;
+    va_start(ap, fmt);
+    int n = vsnprintf(o->p + o->len, o->cap - o->len, fmt, ap);
+    va_end(ap);
+
+    if (n < 0 || (size_t)n >= o->cap - o->len)
+    {
+        o->p[o->len] = '\0';
+        o->full = true;
+        return;
+    }
+    o->len += (size_t)n;
+}
+
+static void head(out_t *o, const char *name, const char *type, const char *help)
+{
+    put(o, "# HELP %s %s\n# TYPE %s %s\n", name, help, name, type);
+}
+
+static void metric(out_t *o, const char *name, const char *type, const char *help, uint32_t v)
+{
+    head(o, name, type, help);
+    put(o, "%s %lu\n", name, (unsigned long)v);
+}
+
+#define GAUGE(o, n, h, v)    metric(o, n, "gauge", h, (uint32_t)(v))
+#define COUNTER(o, n, h, v)  metric(o, n, "counter", h, (uint32_t)(v))
+
+static void render_system(out_t *o)
+{
+    GAUGE(o, "esp_uptime_seconds", "Seconds since boot", esp_timer_get_time() / 1000000);
+    if (g_diag_valid) COUNTER(o, "esp_boot_count", "Boots recorded by ota_diag", g_diag.boot_count);
+
+    GAUGE(o, "esp_heap_free_bytes", "Internal heap free",
+          heap_caps_get_free_size(MALLOC_CAP_INTERNAL));
+    GAUGE(o, "esp_heap_free_min_bytes", "Internal heap low-water mark since boot",
+          heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL));
+    GAUGE(o, "esp_heap_largest_block_bytes", "Largest free internal block",
+          heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL));
+
+    COUNTER(o, "esp_nvs_commits_total", "NVS commits since boot", nvs_stats_commits());
+    COUNTER(o, "esp_nvs_commit_errors_total", "Failed NVS commits since boot", nvs_stats_commit_errors());
+}
+
+static void render_wifi(out_t *o)
+{
+    wifi_stats_t w;
+    wifi_get_stats(&w);
+
+    GAUGE(o, "wifi_connected", "1 while the STA has an IP", w.connected);
+    COUNTER(o, "wifi_connects_total", "IP acquired", w.connects);
+    COUNTER(o, "wifi_retries_total", "Backoff rounds after every network failed", w.retries);
+    COUNTER(o, "wifi_failures_total", "Connect sessions given up", w.failures);
+    COUNTER(o, "wifi_link_losses_total", "Disconnects while connected", w.link_losses);
+    if (w.last_connect_ms >= 0)
+        GAUGE(o, "wifi_last_connect_ms", "STA start to IP, last connect", w.last_connect_ms);
+}
+
+static void render_ota(out_t *o)
+{
+    ota_update_info_t u = ota_update_get_info();
+    const ota_update_timing_t *t = &u.timing;
+
+    ota_state_t st = ota_get_state();
+    head(o, "ota_state", "gauge", "State machine state (1 = current)");
+    put(o, "ota_state{state=\"%s\"} 1\n", ota_state_name(st));
+
+    GAUGE(o, "ota_update_status", "0 idle, 1 running, 2 no update, 3 success, 4 failed", u.status);
+    GAUGE(o, "ota_update_phase", "0 none, 1 manifest, 2 download, 3 verify, 4 install", u.phase);
+    GAUGE(o, "ota_download_bytes", "Bytes written by the current or last update", u.bytes_written);
+    GAUGE(o, "ota_image_bytes", "Image size from the manifest", u.total_size);
+    GAUGE(o, "ota_progress_percent", "Download progress", u.progress_percent);
+    GAUGE(o, "ota_mirror_failovers", "Mirror switches in the current or last download", u.failovers);
+    GAUGE(o, "ota_download_throughput_bytes_per_second", "Last completed download, open to last write",
+          t->total_ms ? (uint64_t)u.bytes_written * 1000 / t->total_ms : 0);
+
+    head(o, "ota_phase_duration_ms", "gauge", "Last update phase timings");
+    put(o, "ota_phase_duration_ms{phase=\"begin\"} %lu\n", (unsigned long)t->begin_ms);
+    put(o, "ota_phase_duration_ms{phase=\"first_write\"} %lu\n", (unsigned long)t->first_write_ms);
+    put(o, "ota_phase_duration_ms{phase=\"read\"} %lu\n", (unsigned long)t->read_ms);
+    put(o, "ota_phase_duration_ms{phase=\"decrypt\"} %lu\n", (unsigned long)t->decrypt_ms);
+    put(o, "ota_phase_duration_ms{phase=\"write\"} %lu\n", (unsigned long)t->write_ms);
+    put(o, "ota_phase_duration_ms{phase=\"verify\"} %lu\n", (unsigned long)t->verify_ms);
+    put(o, "ota_phase_duration_ms{phase=\"verify_wait\"} %lu\n", (unsigned long)t->verify_wait_ms);
+    put(o, "ota_phase_duration_ms{phase=\"total\"} %lu\n", (unsigned long)t->total_ms);
+
+    head(o, "ota_last_error", "gauge", "Error of the current or last update this boot (0 = none)");
+    put(o, "ota_last_error{code=\"%s\"} %u\n", ota_diag_error_short_str((uint16_t)u.error), (unsigned)u.error);
+
+    if (g_diag_valid)
+    {
+        head(o, "ota_boot_last_error", "gauge", "Last recorded update result at boot");
+        put(o, "ota_boot_last_error{status=\"%s\",code=\"%s\"} %u\n",
+            ota_diag_status_str(g_diag.last_status),
+            ota_diag_error_short_str(g_diag.last_error), (unsigned)g_diag.last_error);
+        GAUGE(o, "ota_rollback_seen", "1 if the last boot rolled back", g_diag.rollback_seen);
+    }
+
+    GAUGE(o, "ota_sched_next_check_seconds", "Until the next background check", ota_scheduler_next_check_s());
+    GAUGE(o, "ota_sched_failures", "Failed background checks in a row", ota_scheduler_fail_count());
+    GAUGE(o, "ota_server_backoff_seconds", "Retry-After wait left", server_backoff_remaining_s());
+
+    tls_session_stats_t tls;
+    tls_session_get_stats(&tls);
+    head(o, "ota_tls_handshakes_total", "counter", "TLS handshakes this boot");
+    put(o, "ota_tls_handshakes_total{kind=\"full\"} %lu\n", (unsigned long)tls.full);
+    put(o, "ota_tls_handshakes_total{kind=\"resumed\"} %lu\n", (unsigned long)tls.resumed);
+    head(o, "ota_tls_handshake_ms_total", "counter", "Time spent in TLS handshakes this boot");
+    put(o, "ota_tls_handshake_ms_total{kind=\"full\"} %lu\n", (unsigned long)tls.full_ms);
+    put(o, "ota_tls_handshake_ms_total{kind=\"resumed\"} %lu\n", (unsigned long)tls.resumed_ms);
+    GAUGE(o, "ota_tls_full_handshake_ms", "Measured full-handshake baseline", tls.baseline_ms);
+    GAUGE(o, "ota_tls_saved_ms", "Estimated handshake time saved by session resumption", tls_session_saved_ms(&tls));
+}
+
+size_t metrics_render(char *buf, size_t cap)
+{
+    if (!buf || cap == 0) return 0;
+
+    out_t o = { .p = buf, .cap = cap, .len = 0, .full = false };
+    buf[0] = '\0';
+
+    // First, so they survive a truncated scrape
+    COUNTER(&o, "ota_metrics_scrapes_total", "Scrapes served", g_scrapes);
+    COUNTER(&o, "ota_metrics_truncated_total", "Earlier scrapes that did not fit METRICS_BUF_SIZE", g_truncated);
+
+    render_system(&o);
+    render_wifi(&o);
+    render_ota(&o);
+
+    if (o.full) g_truncated++;
+    return o.len;
+}
+
+/* ---------- HTTP ---------- */
+
+// Local address of the request's socket is the STA's own IP
+static bool from_sta(httpd_req_t *req)
+{
+    if (!METRICS_STA_ONLY) return true;
+
+    esp_netif_ip_info_t ip;
+    esp_netif_t *sta = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+    if (!sta || esp_netif_get_ip_info(sta, &ip) != ESP_OK || ip.ip.addr == 0) return false;
+
+    struct sockaddr_storage ss;
+    socklen_t len = sizeof(ss);
+    if (getsockname(httpd_req_to_sockfd(req), (struct sockaddr*)&ss, &len) != 0) return false;
+
+    uint32_t local;
+    if (ss.ss_family == AF_INET) local = ((struct sockaddr_in*)&ss)->sin_addr.s_addr;
+#if LWIP_IPV6
+    else if (ss.ss_family == AF_INET6) local = ((struct sockaddr_in6*)&ss)->sin6_addr.un.u32_addr[3];   // v4-mapped
+#endif
+    else return false;
+    return local == ip.ip.addr;
+}
+
+static esp_err_t forbid(httpd_req_t *req)
+{
+    return httpd_resp_send_err(req, HTTPD_403_FORBIDDEN, "STA only");
+}
+
+static esp_err_t handle_metrics(httpd_req_t *req)
+{
+    if (!from_sta(req)) return forbid(req);
+
+    g_scrapes++;
+    size_t n = metrics_render(g_buf, sizeof(g_buf));
+
+    httpd_resp_set_type(req, "text/plain; version=0.0.4");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, g_buf, (ssize_t)n);
+}
+
+// Raw tracepoint ring for tools/trace_decode.py, straight from RTC memory
+static esp_err_t handle_trace(httpd_req_t *req)
+{
+    if (!from_sta(req)) return forbid(req);
+
+    httpd_resp_set_type(req, "application/octet-stream");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, (const char*)trace_ring(), (ssize_t)sizeof(trace_ring_t));
+}
+
+void metrics_server_start(void)
+{
+    if (!METRICS_ENABLE || g_http) return;
+
+    g_diag_valid = ota_diag_get_last(&g_diag);
+
+    httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
+    cfg.server_port = METRICS_PORT;
+    cfg.ctrl_port = METRICS_CTRL_PORT;
+    cfg.task_priority = METRICS_TASK_PRIO;
+    cfg.stack_size = METRICS_TASK_STACK;
+    cfg.max_open_sockets = 1;
+    cfg.max_uri_handlers = 2;
+    cfg.lru_purge_enable = true;
+
+    if (httpd_start(&g_http, &cfg) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "httpd start failed");
+        g_http = NULL;
+        return;
+    }
+
+    httpd_uri_t m = {.uri="/metrics", .method=HTTP_GET, .handler=handle_metrics};
+    httpd_register_uri_handler(g_http, &m);
+    httpd_uri_t tr = {.uri="/trace", .method=HTTP_GET, .handler=handle_trace};
+    httpd_register_uri_handler(g_http, &tr);
+    ESP_LOGI(TAG, "serving /metrics on port %d", METRICS_PORT);
+}
@@ -0,0 +1,14 @@
+#ifndef METRICS_SERVER_H
+#define METRICS_SERVER_H
+
+#include <stddef.h>
+
+// Always-on Prometheus endpoint (GET /metrics on METRICS_PORT), separate
+// from the provisioning portal's server; GET /trace returns the raw
+// tracepoint ring. Call after wifi_manager_init().
+void metrics_server_start(void);
+
+// Renders the exposition text into buf (no allocation); returns length
+size_t metrics_render(char *buf, size_t cap);
+
+#endif
@@ -0,0 +1,159 @@
+#include "server_backoff.h"
+#include "config/ota_config.h"
+#include "storage/nvs_stats.h"
+
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+
+#define BACKOFF_NVS_NS    "ota_sched"
+#define BACKOFF_NVS_KEY   "notbefore"   // u32: seconds left when saved
+
+#define VALID_EPOCH       1577836800    // 2020-01-01: wall clock was set by SNTP
+
+static const char *TAG = "backoff";
+
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+static int64_t g_not_before_us = 0;     // esp_timer time
+static bool g_stored = false;           // a wait is saved in NVS
+static int64_t g_saved_us = 0;          // when it was last saved
+
+/* ---------- Retry-After ---------- */
+
+// Days since 1970-01-01 for a civil date (proleptic Gregorian)
+static int64_t days_from_civil(int y, int m, int d)
+{
+    y -= m <= 2;
+    int64_t era = (y >= 0 ? y : y - 399) / 400;
+    int64_t yoe = y - era * 400;
+    int64_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int64_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+// IMF-fixdate only ("Sun, 06 Nov 1994 08:49:37 GMT"); -1 if not parsable
+static int64_t parse_http_date(const char *s)
+{
+    static const char *months = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    char mon[4] = {0};
+    int d, y, hh, mm, ss;
+
+    const char *p = strchr(s, ',');
+    if (!p) return -1;
+    if (sscanf(p + 1, " %d %3s %d %d:%d:%d", &d, mon, &y, &hh, &mm, &ss) != 6) return -1;
+
+    const char *mp = strstr(months, mon);
+    if (!mp || strlen(mon) != 3) return -1;
+    int m = (int)(mp - months) / 3 + 1;
+
+    return days_from_civil(y, m, d) * 86400 + hh * 3600 + mm * 60 + ss;
+}
+
+// Delta-seconds or HTTP-date; a date needs a valid wall clock
+static uint32_t retry_after_s(const char *v)
+{
+    if (!v || !v[0]) return OTA_BUSY_DEFAULT_S;
+
+    while (isspace((unsigned char)*v)) v++;
+    if (isdigit((unsigned char)*v))
+    {
+        unsigned long s = strtoul(v, NULL, 10);
+        return (uint32_t)(s > OTA_BUSY_MAX_S ? OTA_BUSY_MAX_S : s);
+    }
+
+    time_t now = time(NULL);
+    int64_t at = parse_http_date(v);
+    if (at < 0 || now < VALID_EPOCH) return OTA_BUSY_DEFAULT_S;
+    if (at <= now) return 0;
+    return (uint32_t)((at - now) > OTA_BUSY_MAX_S ? OTA_BUSY_MAX_S : (at - now));
+}
+
+/* ---------- Persistence ---------- */
+
+static void save(uint32_t left_s)
+{
+    nvs_handle_t h;
+    if (nvs_open(BACKOFF_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_set_u32(h, BACKOFF_NVS_KEY, left_s);
+    nvs_stats_commit(h);
+    nvs_close(h);
+    g_stored = left_s > 0;
+    g_saved_us = esp_timer_get_time();
+}
+
+static void set_not_before(uint32_t s)
+{
+    portENTER_CRITICAL(&g_mux);
+    g_not_before_us = esp_timer_get_time() + (int64_t)s * 1000000;
+    portEXIT_CRITICAL(&g_mux);
+}
+
+/* ---------- Public API ---------- */
+
+void server_backoff_init(void)
+{
+    nvs_handle_t h;
+    uint32_t left = 0;
+    if (nvs_open(BACKOFF_NVS_NS, NVS_READONLY, &h) != ESP_OK) return;
+    nvs_get_u32(h, BACKOFF_NVS_KEY, &left);
+    nvs_close(h);
+
+    if (left == 0) return;
+
+    // Up to one save period ran before the reboot; count it as gone
+    left = left > OTA_BUSY_SAVE_S ? left - OTA_BUSY_SAVE_S : 0;
+    if (left > OTA_BUSY_MAX_S) left = OTA_BUSY_MAX_S;
+    save(left);
+    if (left > 0)
+    {
+        set_not_before(left);
+        ESP_LOGI(TAG, "server asked to wait, %lu s left", (unsigned long)left);
+    }
+}
+
+void server_backoff_process(void)
+{
+    if (!g_stored) return;
+
+    // Expired waits are cleared, running ones counted down in NVS
+    uint32_t left = server_backoff_remaining_s();
+    if (left == 0 || esp_timer_get_time() - g_saved_us >= (int64_t)OTA_BUSY_SAVE_S * 1000000)
+        save(left);
+}
+
+bool server_backoff_note(int status, const server_reply_t *reply)
+{
+    if (status != 429 && status != 503)
+    {
+        // Served normally again: drop the saved wait so the next boot doesn't replay it
+        if (g_stored && status > 0 && status < 500) save(0);
+        return false;
+    }
+
+    uint32_t s = retry_after_s(reply ? reply->retry_after : NULL);
+    if (s == 0) s = 1;
+
+    // Never shorten a wait we were already given
+    if (s > server_backoff_remaining_s())
+    {
+        set_not_before(s);
+        save(s);
+    }
+    ESP_LOGW(TAG, "HTTP %d, not before +%lu s", status, (unsigned long)server_backoff_remaining_s());
+    return true;
+}
+
+uint32_t server_backoff_remaining_s(void)
+{
+    portENTER_CRITICAL(&g_mux);
+    int64_t left = g_not_before_us - esp_timer_get_time();
+    portEXIT_CRITICAL(&g_mux);
+
+    return (left > 0) ? (uint32_t)((left + 999999) / 1000000) : 0;
+}
@@ -0,0 +1,27 @@
+#ifndef SERVER_BACKOFF_H
+#define SERVER_BACKOFF_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Server back-pressure (429/503 + Retry-After) shared by every OTA request:
+// once the origin asks us to wait, nothing is sent until the "not before"
+// time passes. Kept in NVS so a reboot doesn't reset it.
+
+// Response headers server_backoff_note needs (tls_reply_t.server)
+typedef struct {
+    char retry_after[40];
+} server_reply_t;
+
+void server_backoff_init(void);
+
+// Call from the main loop: keeps the saved wait counting down, clears it once over
+void server_backoff_process(void);
+
+// Feed every response status; returns true for back-pressure (429/503)
+bool server_backoff_note(int status, const server_reply_t *reply);
+
+// Seconds until requests are allowed again, 0 = now
+uint32_t server_backoff_remaining_s(void);
+
+#endif
@@ -0,0 +1,602 @@
+#include "tls_session.h"
+#include "http_client.h"
+#include "config/ota_config.h"
+#include "storage/ota_diag.h"
+#include "storage/mem_monitor.h"
+#include "storage/trace.h"
+
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_rom_crc.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include "mbedtls/ssl.h"
+#include "mbedtls/net_sockets.h"
+#include "mbedtls/sha256.h"
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <errno.h>
+#include <time.h>
+
+#if OTA_USE_CRT_BUNDLE
+#include "esp_crt_bundle.h"
+#else
+#include "mbedtls/x509_crt.h"
+#endif
+
+static const char *TAG = "TLS_SESSION";
+
+#define CACHE_MAGIC     0x544c5331u     // "TLS1"
+
+/* ---------- Session cache ---------- */
+
+// RTC memory and the system clock both survive software resets and are
+// both lost at power-on, so an expiry in time() seconds stays meaningful
+typedef struct {
+    char host[72];              // "host:port", "" = free
+    uint32_t expires;           // time()
+    uint32_t last_used;         // g_cache.use_seq
+    uint8_t master_tag[8];      // SHA-256 prefix of the master secret
+    uint16_t len;
+    uint8_t data[OTA_TLS_SESSION_MAX];  // mbedtls_ssl_session_save()
+} tls_slot_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t size;              // layout check across firmware updates
+    uint32_t use_seq;
+    uint32_t baseline_ms;       // full handshake, moving average
+    tls_slot_t slot[OTA_TLS_CACHE_SLOTS];
+    uint32_t crc;               // over everything above
+} tls_cache_t;
+
+// Not zeroed at boot; validated by magic/size/crc instead
+static RTC_NOINIT_ATTR tls_cache_t g_cache;
+static SemaphoreHandle_t g_lock = NULL;     // g_cache
+
+static tls_session_stats_t g_stats;         // this boot
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t cache_crc(void)
+{
+    return esp_rom_crc32_le(0, (const uint8_t*)&g_cache, offsetof(tls_cache_t, crc));
+}
+
+// Called with g_lock held
+static tls_slot_t *find_slot(const char *key)
+{
+    for (int i = 0; i < OTA_TLS_CACHE_SLOTS; i++)
+    {
+        if (g_cache.slot[i].host[0] && strcmp(g_cache.slot[i].host, key) == 0) return &g_cache.slot[i];
+    }
+    return NULL;
+}
+
+// Free slot, else the least recently used. Called with g_lock held.
+static tls_slot_t *victim(void)
+{
+    tls_slot_t *v = &g_cache.slot[0];
+    for (int i = 0; i < OTA_TLS_CACHE_SLOTS; i++)
+    {
+        tls_slot_t *s = &g_cache.slot[i];
+        if (!s->host[0]) return s;
+        if (s->last_used < v->last_used) v = s;
+    }
+    return v;
+}
+
+// Saved session for key into sess, false if there is none or it expired
+static bool cache_load(const char *key, mbedtls_ssl_session *sess, uint8_t tag[8])
+{
+    bool ok = false;
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    tls_slot_t *s = find_slot(key);
+    if (s)
+    {
+        if ((int32_t)(s->expires - (uint32_t)time(NULL)) <= 0)
+        {
+            s->host[0] = '\0';
+            g_cache.crc = cache_crc();
+        }
+        else if (mbedtls_ssl_session_load(sess, s->data, s->len) == 0)
+        {
+            memcpy(tag, s->master_tag, sizeof(s->master_tag));
+            ok = true;
+        }
+    }
+    xSemaphoreGive(g_lock);
+    return ok;
+}
+
+// fresh: a full handshake, the session's lifetime starts now
+static void cache_store(const char *key, const mbedtls_ssl_session *sess, const uint8_t tag[8], bool fresh)
+{
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    tls_slot_t *s = find_slot(key);
+    uint32_t expires = (s && !fresh) ? s->expires : (uint32_t)time(NULL) + OTA_TLS_SESSION_TTL_S;
+    if (!s) s = victim();
+
+    size_t len = 0;
+    if (mbedtls_ssl_session_save(sess, s->data, sizeof(s->data), &len) == 0)
+    {
+        snprintf(s->host, sizeof(s->host), "%s", key);
+        s->expires = expires;
+        s->last_used = ++g_cache.use_seq;
+        memcpy(s->master_tag, tag, sizeof(s->master_tag));
+        s->len = (uint16_t)len;
+    }
+    else
+    {
+        s->host[0] = '\0';
+        ESP_LOGW(TAG, "%s: session bigger than OTA_TLS_SESSION_MAX, not kept", key);
+    }
+    g_cache.crc = cache_crc();
+    xSemaphoreGive(g_lock);
+}
+
+static void cache_drop(const char *key)
+{
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    tls_slot_t *s = find_slot(key);
+    if (s)
+    {
+        s->host[0] = '\0';
+        g_cache.crc = cache_crc();
+    }
+    xSemaphoreGive(g_lock);
+}
+
+// known_full: certainly a full handshake, so it may move the baseline
+static void note_handshake(bool resumed, bool known_full, uint32_t ms)
+{
+    if (known_full)
+    {
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        g_cache.baseline_ms = g_cache.baseline_ms ? (3 * g_cache.baseline_ms + ms) / 4 : ms;
+        g_cache.crc = cache_crc();
+        xSemaphoreGive(g_lock);
+    }
+
+    portENTER_CRITICAL(&g_mux);
+    if (resumed)
+    {
+        g_stats.resumed++;
+        g_stats.resumed_ms += ms;
+    }
+    else
+    {
+        g_stats.full++;
+        g_stats.full_ms += ms;
+    }
+    portEXIT_CRITICAL(&g_mux);
+
+    TRACE(TR_TLS_OPEN, resumed, ms);
+}
+
+/* ---------- Connection ---------- */
+
+struct tls_conn {
+    int fd;
+    bool tls;
+    bool established;
+    mbedtls_ssl_context ssl;
+    mbedtls_ssl_config conf;
+#if !OTA_USE_CRT_BUNDLE
+    mbedtls_x509_crt ca;
+#endif
+    uint8_t master_tag[8];      // this handshake's, from the export-keys callback
+    bool have_tag;              // TLS 1.2 only: 1.3 exports no master secret
+    char key[sizeof(g_cache.slot[0].host)];
+    bool saved;                 // session stored since the handshake
+
+    http_stream_t http;
+};
+
+static int rng(void *ctx, unsigned char *buf, size_t len)
+{
+    (void)ctx;
+    esp_fill_random(buf, len);      // hardware RNG; with Wi-Fi up it is a true RNG
+    return 0;
+}
+
+static void set_sock_timeout(int fd, int ms)
+{
+    struct timeval tv = { .tv_sec = ms / 1000, .tv_usec = (ms % 1000) * 1000 };
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+}
+
+// Blocking socket with SO_*TIMEO: a timeout is an error, never WANT_READ
+static int bio_send(void *ctx, const unsigned char *buf, size_t len)
+{
+    int n = send(*(int*)ctx, buf, len, 0);
+    return n >= 0 ? n : MBEDTLS_ERR_NET_SEND_FAILED;
+}
+
+static int bio_recv(void *ctx, unsigned char *buf, size_t len)
+{
+    int n = recv(*(int*)ctx, buf, len, 0);
+    if (n >= 0) return n;
+    return (errno == EAGAIN || errno == EWOULDBLOCK) ? MBEDTLS_ERR_SSL_TIMEOUT : MBEDTLS_ERR_NET_RECV_FAILED;
+}
+
+static void on_keys(void *p, mbedtls_ssl_key_export_type type, const unsigned char *secret, size_t len,
+                    const unsigned char client_random[32], const unsigned char server_random[32],
+                    mbedtls_tls_prf_types prf)
+{
+    (void)client_random; (void)server_random; (void)prf;
+    if (type != MBEDTLS_SSL_KEY_EXPORT_TLS12_MASTER_SECRET) return;
+
+    tls_conn_t *c = (tls_conn_t*)p;
+    uint8_t h[32];
+    mbedtls_sha256(secret, len, h, 0);
+    memcpy(c->master_tag, h, sizeof(c->master_tag));
+    c->have_tag = true;
+}
+
+/* ---------- DNS ---------- */
+
+// A lookup handed to its own task: lwIP's resolver only gives up after its
+// own retries, so the caller waits at most its timeout and leaves the rest
+// to whichever side finishes last
+typedef struct {
+    char host[64];
+    char port[8];
+    struct addrinfo *res;
+    int err;
+    SemaphoreHandle_t done;
+    int refs;                   // caller + task, under g_mux
+} dns_job_t;
+
+static void dns_job_put(dns_job_t *j)
+{
+    portENTER_CRITICAL(&g_mux);
+    bool last = --j->refs == 0;
+    portEXIT_CRITICAL(&g_mux);
+    if (!last) return;
+
+    if (j->res) freeaddrinfo(j->res);
+    vSemaphoreDelete(j->done);
+    free(j);
+}
+
+static void dns_task(void *arg)
+{
+    dns_job_t *j = (dns_job_t*)arg;
+    mem_monitor_task_enter(OTA_DNS_TASK_STACK);
+
+    struct addrinfo hints = { .ai_family = AF_UNSPEC, .ai_socktype = SOCK_STREAM };
+    j->err = getaddrinfo(j->host, j->port, &hints, &j->res);
+    xSemaphoreGive(j->done);
+    dns_job_put(j);
+
+    mem_monitor_task_exit();
+    vTaskDelete(NULL);
+}
+
+struct addrinfo *tls_session_resolve(const char *host, const char *port, int timeout_ms)
+{
+    dns_job_t *j = calloc(1, sizeof(*j));
+    if (!j) return NULL;
+    snprintf(j->host, sizeof(j->host), "%s", host);
+    snprintf(j->port, sizeof(j->port), "%s", port);
+    j->done = xSemaphoreCreateBinary();
+    j->refs = 2;
+    if (!j->done || xTaskCreate(dns_task, "tls_dns", OTA_DNS_TASK_STACK, j, uxTaskPriorityGet(NULL), NULL) != pdPASS)
+    {
+        if (j->done) vSemaphoreDelete(j->done);
+        free(j);
+        ESP_LOGE(TAG, "%s: no memory for the lookup", host);
+        return NULL;
+    }
+
+    struct addrinfo *res = NULL;
+    if (xSemaphoreTake(j->done, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) ESP_LOGW(TAG, "%s: lookup timed out", host);
+    else if (j->err != 0 || !j->res) ESP_LOGW(TAG, "%s: no address", host);
+    else
+    {
+        res = j->res;
+        j->res = NULL;
+    }
+    dns_job_put(j);
+    return res;
+}
+
+/* ---------- TCP ---------- */
+
+// Non-blocking connect bounded by timeout_ms, then blocking I/O
+static int connect_addr(const struct addrinfo *ai, int timeout_ms)
+{
+    int fd = socket(ai->ai_family, ai->ai_socktype, 0);
+    if (fd < 0) return -1;
+
+    int fl = fcntl(fd, F_GETFL, 0);
+    fcntl(fd, F_SETFL, fl | O_NONBLOCK);
+    int r = connect(fd, ai->ai_addr, ai->ai_addrlen);
+    if (r != 0 && errno == EINPROGRESS)
+    {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        FD_SET(fd, &wfds);
+        struct timeval tv = { .tv_sec = timeout_ms / 1000, .tv_usec = (timeout_ms % 1000) * 1000 };
+        int e = 0;
+        socklen_t len = sizeof(e);
+        if (select(fd + 1, NULL, &wfds, NULL, &tv) == 1 &&
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &e, &len) == 0 && e == 0) r = 0;
+    }
+    if (r != 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fl);
+    set_sock_timeout(fd, timeout_ms);
+    return fd;
+}
+
+// IPv4 or IPv6, each address the name resolved to in turn
+static int tcp_connect(const http_url_t *u, int timeout_ms)
+{
+    struct addrinfo *res = tls_session_resolve(u->host, u->port, timeout_ms);
+    if (!res) return -1;
+
+    int fd = -1;
+    for (const struct addrinfo *ai = res; ai && fd < 0; ai = ai->ai_next) fd = connect_addr(ai, timeout_ms);
+    if (fd < 0) ESP_LOGW(TAG, "%s:%s: connect failed", u->host, u->port);
+
+    freeaddrinfo(res);
+    return fd;
+}
+
+// Stores the connection's session for the next one to the host. A TLS 1.3
+// ticket only arrives after the handshake, so release tries again.
+static void save_session(tls_conn_t *c, bool fresh)
+{
+    mbedtls_ssl_session sess;
+    mbedtls_ssl_session_init(&sess);
+    if (mbedtls_ssl_get_session(&c->ssl, &sess) == 0)
+    {
+        cache_store(c->key, &sess, c->master_tag, fresh);
+        c->saved = true;
+    }
+    mbedtls_ssl_session_free(&sess);
+}
+
+static bool tls_handshake(tls_conn_t *c, const http_url_t *u)
+{
+    if (mbedtls_ssl_config_defaults(&c->conf, MBEDTLS_SSL_IS_CLIENT, MBEDTLS_SSL_TRANSPORT_STREAM,
+                                    MBEDTLS_SSL_PRESET_DEFAULT) != 0) return false;
+    mbedtls_ssl_conf_authmode(&c->conf, MBEDTLS_SSL_VERIFY_REQUIRED);
+    mbedtls_ssl_conf_rng(&c->conf, rng, NULL);
+    mbedtls_ssl_conf_session_tickets(&c->conf, MBEDTLS_SSL_SESSION_TICKETS_ENABLED);
+#if OTA_USE_CRT_BUNDLE
+    // Stays attached: detaching frees the shared bundle under other connections
+    if (esp_crt_bundle_attach(&c->conf) != ESP_OK) return false;
+#else
+    if (mbedtls_x509_crt_parse(&c->ca, (const unsigned char*)ROOT_CA_PEM, strlen(ROOT_CA_PEM) + 1) != 0) return false;
+    mbedtls_ssl_conf_ca_chain(&c->conf, &c->ca, NULL);
+#endif
+    if (mbedtls_ssl_setup(&c->ssl, &c->conf) != 0 || mbedtls_ssl_set_hostname(&c->ssl, u->host) != 0) return false;
+    mbedtls_ssl_set_bio(&c->ssl, &c->fd, bio_send, bio_recv, NULL);
+    mbedtls_ssl_set_export_keys_cb(&c->ssl, on_keys, c);
+
+    snprintf(c->key, sizeof(c->key), "%s:%s", u->host, u->port);
+
+    mbedtls_ssl_session sess;
+    mbedtls_ssl_session_init(&sess);
+    uint8_t offered_tag[8];
+    bool offered = cache_load(c->key, &sess, offered_tag) && mbedtls_ssl_set_session(&c->ssl, &sess) == 0;
+    mbedtls_ssl_session_free(&sess);
+
+    int64_t t0 = esp_timer_get_time();
+    int r = mbedtls_ssl_handshake(&c->ssl);
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+    if (r != 0)
+    {
+        ESP_LOGE(TAG, "%s: handshake failed -0x%04x%s", c->key, (unsigned)-r, offered ? ", session dropped" : "");
+        if (offered) cache_drop(c->key);
+        return false;
+    }
+    c->established = true;
+
+    // TLS 1.2: the same master secret as the saved session means the server
+    // resumed it. TLS 1.3 has no such sign, so an offered session there
+    // counts as a full handshake but leaves the baseline alone.
+    bool resumed = offered && c->have_tag && memcmp(c->master_tag, offered_tag, sizeof(offered_tag)) == 0;
+    if (offered && c->have_tag && !resumed) ESP_LOGI(TAG, "%s: saved session refused", c->key);
+
+    // Saved again after a resumption too: the server may have renewed the ticket
+    save_session(c, !resumed);
+
+    note_handshake(resumed, !offered || (c->have_tag && !resumed), ms);
+    return true;
+}
+
+// http_stream_t transport
+static int conn_send(void *ctx, const void *buf, size_t len)
+{
+    tls_conn_t *c = (tls_conn_t*)ctx;
+    const char *p = (const char*)buf;
+    while (len > 0)
+    {
+        int n = c->tls ? mbedtls_ssl_write(&c->ssl, (const unsigned char*)p, len) : send(c->fd, p, len, 0);
+        if (n <= 0) return -1;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int conn_recv(void *ctx, void *buf, size_t len)
+{
+    tls_conn_t *c = (tls_conn_t*)ctx;
+    if (!c->tls) return recv(c->fd, buf, len, 0);
+
+    int n;
+    do
+    {
+        n = mbedtls_ssl_read(&c->ssl, (unsigned char*)buf, len);
+    }
+#ifdef MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET
+    while (n == MBEDTLS_ERR_SSL_RECEIVED_NEW_SESSION_TICKET);  // TLS 1.3 ticket, no data
+#else
+    while (0);
+#endif
+    return n == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ? 0 : n;
+}
+
+/* ---------- Public API ---------- */
+
+void tls_session_init(void)
+{
+    if (g_lock) return;
+    g_lock = xSemaphoreCreateMutex();
+
+    if (g_cache.magic != CACHE_MAGIC || g_cache.size != sizeof(g_cache) || g_cache.crc != cache_crc())
+    {
+        // Power-on (RTC memory is random) or a different layout
+        memset(&g_cache, 0, sizeof(g_cache));
+        g_cache.magic = CACHE_MAGIC;
+        g_cache.size = sizeof(g_cache);
+        g_cache.crc = cache_crc();
+        return;
+    }
+
+    int n = 0;
+    for (int i = 0; i < OTA_TLS_CACHE_SLOTS; i++) n += g_cache.slot[i].host[0] != '\0';
+    ESP_LOGI(TAG, "%d saved session(s), full handshake ~%lu ms", n, (unsigned long)g_cache.baseline_ms);
+}
+
+// One GET on a fresh connection, no redirects
+static tls_conn_t *get_once(const http_url_t *u, size_t offset, int timeout_ms, tls_reply_t *reply)
+{
+    tls_conn_t *c = calloc(1, sizeof(*c));
+    if (!c) return NULL;
+    c->fd = -1;
+    c->tls = u->tls;
+    mbedtls_ssl_init(&c->ssl);
+    mbedtls_ssl_config_init(&c->conf);
+#if !OTA_USE_CRT_BUNDLE
+    mbedtls_x509_crt_init(&c->ca);
+#endif
+    http_stream_init(&c->http, conn_recv, conn_send, c);
+
+    c->fd = tcp_connect(u, timeout_ms);
+    if (c->fd < 0 || (c->tls && !tls_handshake(c, u)))
+    {
+        tls_session_release(c);
+        return NULL;
+    }
+    if (!http_send_get(&c->http, u, offset) || !http_read_head(&c->http, reply))
+    {
+        ESP_LOGW(TAG, "%s: no response head", u->host);
+        tls_session_release(c);
+        return NULL;
+    }
+    return c;
+}
+
+tls_conn_t *tls_session_get(const char *url, size_t offset, int timeout_ms, tls_reply_t *reply)
+{
+    memset(reply, 0, sizeof(*reply));
+    reply->content_length = -1;
+
+    char next[OTA_HTTP_URL_MAX];
+    for (int hop = 0; ; hop++)
+    {
+        http_url_t u;
+        if (!http_parse_url(url, &u))
+        {
+            ESP_LOGE(TAG, "bad url %s", url);
+            return NULL;
+        }
+
+        tls_conn_t *c = get_once(&u, offset, timeout_ms, reply);
+        if (!c || !http_is_redirect(reply)) return c;
+
+        // Past the limit, or somewhere unusable: the caller gets the 3xx
+        char to[sizeof(next)];
+        if (hop == OTA_HTTP_MAX_REDIRECTS || !http_resolve_location(&u, reply->location, to, sizeof(to)))
+        {
+            ESP_LOGW(TAG, "%d from %s not followed", reply->status, u.host);
+            return c;
+        }
+        ESP_LOGI(TAG, "%d -> %s", reply->status, to);
+        tls_session_release(c);
+
+        // u.path pointed into url, which may be next itself
+        memcpy(next, to, sizeof(next));
+        url = next;
+    }
+}
+
+int tls_session_read(tls_conn_t *c, void *buf, size_t len)
+{
+    return c ? http_read_body(&c->http, buf, len) : -1;
+}
+
+void tls_session_set_timeout_ms(tls_conn_t *c, int timeout_ms)
+{
+    if (c && c->fd >= 0) set_sock_timeout(c->fd, timeout_ms);
+}
+
+void tls_session_release(tls_conn_t *c)
+{
+    if (!c) return;
+
+    if (c->established)
+    {
+        if (!c->saved) save_session(c, true);
+        mbedtls_ssl_close_notify(&c->ssl);
+    }
+    mbedtls_ssl_free(&c->ssl);
+    mbedtls_ssl_config_free(&c->conf);
+#if !OTA_USE_CRT_BUNDLE
+    mbedtls_x509_crt_free(&c->ca);
+#endif
+    if (c->fd >= 0) close(c->fd);
+    free(c);
+}
+
+void tls_session_get_stats(tls_session_stats_t *out)
+{
+    portENTER_CRITICAL(&g_mux);
+    *out = g_stats;
+    portEXIT_CRITICAL(&g_mux);
+    out->baseline_ms = g_cache.baseline_ms;
+}
+
+uint32_t tls_session_saved_ms(const tls_session_stats_t *s)
+{
+    if (s->resumed == 0 || s->baseline_ms == 0) return 0;
+
+    uint64_t as_full = (uint64_t)s->baseline_ms * s->resumed;
+    return as_full > s->resumed_ms ? (uint32_t)(as_full - s->resumed_ms) : 0;
+}
+
+void tls_session_record_diag(void)
+{
+    tls_session_stats_t s;
+    tls_session_get_stats(&s);
+
+    ota_diag_tls_t d = {
+        .full = s.full,
+        .resumed = s.resumed,
+        .full_ms = s.full_ms,
+        .resumed_ms = s.resumed_ms,
+        .saved_ms = tls_session_saved_ms(&s),
+    };
+    ESP_LOGI(TAG, "handshakes: %lu full (%lu ms), %lu resumed (%lu ms), ~%lu ms saved",
+             (unsigned long)d.full, (unsigned long)d.full_ms,
+             (unsigned long)d.resumed, (unsigned long)d.resumed_ms, (unsigned long)d.saved_ms);
+    ota_diag_record_tls(&d);
+}
@@ -0,0 +1,62 @@
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "http_client.h"
+
+struct addrinfo;
+
+// HTTPS GET straight on mbedtls (HTTP/1.1 in http_client.c), with the TLS
+// session of each host kept in RTC memory (OTA_TLS_CACHE_SLOTS) so the next
+// connection, also after a software reset, resumes it instead of doing a
+// full handshake. The server decides: an expired or unknown session just
+// costs a full handshake.
+// http:// URLs work too, over plain TCP.
+
+// Response head (status, Content-Length, Retry-After, Content-Range)
+typedef http_reply_t tls_reply_t;
+
+typedef struct tls_conn tls_conn_t;
+
+typedef struct {
+    uint32_t full;          // no saved session, refused, or TLS 1.3 (resumption not visible)
+    uint32_t resumed;       // the server accepted the saved session (TLS 1.2)
+    uint32_t full_ms;       // total handshake time, TCP connect excluded
+    uint32_t resumed_ms;
+    uint32_t baseline_ms;   // full handshake, moving average kept with the sessions
+} tls_session_stats_t;
+
+// Validates the RTC session cache; call in app_main before anything connects
+void tls_session_init(void);
+
+// GET url, from offset ("Range: bytes=<offset>-") when offset > 0, and read
+// the response head into *reply. Redirects are followed up to
+// OTA_HTTP_MAX_REDIRECTS; past that the 3xx is returned. NULL if no response
+// arrived; otherwise the caller owns the connection.
+tls_conn_t *tls_session_get(const char *url, size_t offset, int timeout_ms, tls_reply_t *reply);
+
+// getaddrinfo, IPv4 or IPv6, waiting at most timeout_ms; NULL on failure,
+// otherwise free with freeaddrinfo()
+struct addrinfo *tls_session_resolve(const char *host, const char *port, int timeout_ms);
+
+// Body bytes, chunked coding removed: > 0 read, 0 at the end of the body,
+// < 0 error, timeout or connection closed early
+int tls_session_read(tls_conn_t *c, void *buf, size_t len);
+
+// Socket timeout for everything after this call
+void tls_session_set_timeout_ms(tls_conn_t *c, int timeout_ms);
+
+// Closes and frees c (NULL is fine); the host's session stays cached
+void tls_session_release(tls_conn_t *c);
+
+void tls_session_get_stats(tls_session_stats_t *out);
+
+// Estimated handshake time saved this boot: resumptions at the measured
+// full-handshake baseline minus what they actually took
+uint32_t tls_session_saved_ms(const tls_session_stats_t *s);
+
+// Stores this boot's stats as the ota_diag TLS record
+void tls_session_record_diag(void);
+
+#endif
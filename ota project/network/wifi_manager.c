@@ -1,51 +1,470 @@
 #include "wifi_manager.h"
 #include "storage/wifi_nvs.h"
+#include "storage/trace.h"
+#include "config/wifi_config.h"
 
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
 #include "nvs_flash.h"
 #include "esp_netif.h"
 #include <string.h>
+#include <stdio.h>
 
 static const char *TAG = "WIFI_MGR";
 
+// Private events: timer callbacks hand work to the event task, so the phase
+// machine only ever runs there
+ESP_EVENT_DEFINE_BASE(WIFI_MGR_EVENT);
+enum { WIFI_MGR_EVENT_RETRY };
+
+// Ranking: score = RSSI (dBm) + successes (capped by wifi_nvs) + bonus for the last network used
+#define RANK_RECENT_BONUS   5
+
+typedef enum {
+    PH_IDLE = 0,
+    PH_FAST,            // pinned to cached BSSID/channel, no scan
+    PH_SCANNING,
+    PH_TRYING,          // working through ranked candidates
+    PH_CONNECTED
+} wifi_phase_t;
+
+typedef struct {
+    int net;            // index into known_nets
+    int score;
+    int8_t rssi;
+    uint8_t bssid[6];
+    uint8_t channel;
+} wifi_candidate_t;
+
 static bool wifi_connected = false;
 static bool wifi_failed = false;
 static int retry_count = 0;
 
-#define MAX_WIFI_RETRY  3
+static esp_netif_t *sta_netif = NULL;
+static esp_timer_handle_t retry_timer = NULL;
+static esp_timer_handle_t attempt_timer = NULL;
+
+static wifi_phase_t phase = PH_IDLE;
+static bool scan_ours = false;          // SCAN_DONE belongs to begin_scan, not the portal
+static bool sta_started = false;        // driver running with STA interface (STA or APSTA)
+
+// Known networks and the ranked candidates from the last scan
+static wifi_nvs_net_t known_nets[WIFI_NVS_MAX_NETS];
+static int known_count = 0;
+static wifi_candidate_t cands[WIFI_NVS_MAX_NETS];
+static int cand_count = 0;
+static int cand_pos = 0;
+static wifi_ap_record_t scan_recs[WIFI_SCAN_MAX_AP];   // static: event task stack is small
+static char cur_ssid[32];
+
+// Fast reconnect state
+static wifi_nvs_fast_t fast_cache;
+static bool lease_reused = false;       // cached lease applied as static IP
+static bool last_was_fast = false;
+static int64_t connect_start_us = 0;
+static int last_connect_ms = -1;
+
+static wifi_stats_t stats;      // written by the event task only
+
+static void begin_scan(void);
+
+/* ---------- Backoff ---------- */
+
+// base * 2^(n-1), capped, then jittered into [d/2, d] so devices that lost
+// the same AP don't retry in lockstep.
+static uint32_t backoff_ms(int attempt)
+{
+    uint32_t d = WIFI_BACKOFF_BASE_MS;
+    for (int i = 1; i < attempt && d < WIFI_BACKOFF_MAX_MS; i++) d <<= 1;
+    if (d > WIFI_BACKOFF_MAX_MS) d = WIFI_BACKOFF_MAX_MS;
+
+    uint32_t half = d / 2;
+    return half + (esp_random() % (half + 1));
+}
+
+static void retry_timer_cb(void *arg)
+{
+    (void)arg;
+    // Event queue full: try again shortly rather than lose the retry
+    if (esp_event_post(WIFI_MGR_EVENT, WIFI_MGR_EVENT_RETRY, NULL, 0, 0) != ESP_OK)
+        esp_timer_start_once(retry_timer, 100 * 1000ULL);
+}
+
+// Per-network timeout: abort the attempt, DISCONNECTED moves on to the next one
+static void attempt_timer_cb(void *arg)
+{
+    (void)arg;
+    ESP_LOGW(TAG, "Attempt on '%s' timed out", cur_ssid);
+    esp_wifi_disconnect();
+}
+
+// Every candidate (or the scan itself) failed: back off, then scan again
+static void round_failed(void)
+{
+    if (retry_count < WIFI_MAX_RETRY)
+    {
+        retry_count++;
+        stats.retries++;
+        uint32_t delay = backoff_ms(retry_count);
+        ESP_LOGW(TAG, "Retrying WiFi (%d) in %u ms", retry_count, (unsigned)delay);
+        phase = PH_SCANNING;
+        esp_timer_stop(retry_timer);
+        esp_timer_start_once(retry_timer, (uint64_t)delay * 1000ULL);
+    }
+    else
+    {
+        phase = PH_IDLE;
+        wifi_failed = true;
+        stats.failures++;
+        ESP_LOGE(TAG, "WiFi connection failed");
+    }
+}
+
+/* ---------- Targeting ---------- */
+
+static void set_sta_target(const wifi_nvs_net_t *n, const uint8_t *bssid, uint8_t channel)
+{
+    wifi_config_t wifi_cfg = {0};
+    strncpy((char*)wifi_cfg.sta.ssid, n->ssid, sizeof(wifi_cfg.sta.ssid) - 1);
+    strncpy((char*)wifi_cfg.sta.password, n->pass, sizeof(wifi_cfg.sta.password) - 1);
+    wifi_cfg.sta.sort_method = WIFI_CONNECT_AP_BY_SIGNAL;
+    wifi_cfg.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+
+    if (bssid && channel)
+    {
+        memcpy(wifi_cfg.sta.bssid, bssid, sizeof(wifi_cfg.sta.bssid));
+        wifi_cfg.sta.bssid_set = true;
+        wifi_cfg.sta.channel = channel;
+        wifi_cfg.sta.scan_method = WIFI_FAST_SCAN;
+    }
+
+    snprintf(cur_ssid, sizeof(cur_ssid), "%s", n->ssid);
+    esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg);
+}
+
+static void start_attempt(void)
+{
+    esp_timer_stop(attempt_timer);
+    esp_timer_start_once(attempt_timer, (uint64_t)WIFI_NET_TIMEOUT_MS * 1000ULL);
+    esp_wifi_connect();
+}
+
+static void try_next_candidate(void)
+{
+    if (cand_pos >= cand_count)
+    {
+        round_failed();
+        return;
+    }
+
+    const wifi_candidate_t *c = &cands[cand_pos];
+    if (c->channel)
+        ESP_LOGI(TAG, "Trying '%s' (rssi=%d ch=%u, %d/%d)",
+                 known_nets[c->net].ssid, c->rssi, c->channel, cand_pos + 1, cand_count);
+    else
+        ESP_LOGI(TAG, "Trying '%s' (not in scan, maybe hidden, %d/%d)",
+                 known_nets[c->net].ssid, cand_pos + 1, cand_count);
+
+    phase = PH_TRYING;
+    set_sta_target(&known_nets[c->net], c->channel ? c->bssid : NULL, c->channel);
+    start_attempt();
+}
+
+/* ---------- Scan + ranking ---------- */
+
+static void begin_scan(void)
+{
+    wifi_scan_config_t sc = {0};
+    sc.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+
+    phase = PH_SCANNING;
+    scan_ours = true;
+    if (esp_wifi_scan_start(&sc, false) != ESP_OK)
+    {
+        scan_ours = false;
+        ESP_LOGW(TAG, "Scan start failed");
+        round_failed();
+    }
+}
+
+static void on_scan_done(void)
+{
+    uint16_t n = WIFI_SCAN_MAX_AP;
+    if (esp_wifi_scan_get_ap_records(&n, scan_recs) != ESP_OK) n = 0;
+
+    uint32_t newest = 0;
+    for (int k = 0; k < known_count; k++)
+    {
+        if (known_nets[k].last_success > newest) newest = known_nets[k].last_success;
+    }
+
+    cand_count = 0;
+    cand_pos = 0;
+
+    for (int k = 0; k < known_count; k++)
+    {
+        // Strongest BSS advertising this SSID
+        int best = -1;
+        for (int i = 0; i < n; i++)
+        {
+            if (strncmp((const char*)scan_recs[i].ssid, known_nets[k].ssid, sizeof(known_nets[k].ssid)) != 0)
+                continue;
+            if (best < 0 || scan_recs[i].rssi > scan_recs[best].rssi) best = i;
+        }
+        if (best < 0) continue;
+
+        wifi_candidate_t c = {0};
+        c.net = k;
+        c.rssi = scan_recs[best].rssi;
+        c.channel = scan_recs[best].primary;
+        memcpy(c.bssid, scan_recs[best].bssid, sizeof(c.bssid));
+
+        int hist = known_nets[k].success_count;
+        if (hist > WIFI_NVS_SUCCESS_CAP) hist = WIFI_NVS_SUCCESS_CAP;   // older stores counted higher
+        c.score = c.rssi + hist;
+        if (newest && known_nets[k].last_success == newest) c.score += RANK_RECENT_BONUS;
+
+        // Insertion sort, best score first
+        int pos = cand_count++;
+        while (pos > 0 && cands[pos - 1].score < c.score)
+        {
+            cands[pos] = cands[pos - 1];
+            pos--;
+        }
+        cands[pos] = c;
+    }
+
+    int seen = cand_count;
+
+    // Hidden SSIDs never show up in a scan: try those not seen last,
+    // unpinned, so the driver probes for them by name on every channel
+    for (int k = 0; k < known_count && cand_count < WIFI_NVS_MAX_NETS; k++)
+    {
+        bool found = false;
+        for (int i = 0; i < seen; i++)
+        {
+            if (cands[i].net == k) { found = true; break; }
+        }
+        if (found) continue;
+
+        wifi_candidate_t c = {0};
+        c.net = k;
+        cands[cand_count++] = c;
+    }
+
+    ESP_LOGI(TAG, "Scan: %u APs, %d known in range, %d not seen", (unsigned)n, seen, cand_count - seen);
+    try_next_candidate();
+}
+
+/* ---------- Fast reconnect ---------- */
+
+#if WIFI_FAST_REUSE_LEASE
+static void apply_cached_lease(void)
+{
+    if (!sta_netif || fast_cache.ip == 0) return;
+
+    esp_netif_dhcpc_stop(sta_netif);
+
+    esp_netif_ip_info_t ip = {0};
+    ip.ip.addr = fast_cache.ip;
+    ip.gw.addr = fast_cache.gw;
+    ip.netmask.addr = fast_cache.netmask;
+    if (esp_netif_set_ip_info(sta_netif, &ip) != ESP_OK)
+    {
+        esp_netif_dhcpc_start(sta_netif);
+        return;
+    }
+
+    if (fast_cache.dns)
+    {
+        esp_netif_dns_info_t dns = {0};
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4.addr = fast_cache.dns;
+        esp_netif_set_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+
+    lease_reused = true;
+}
+#endif
+
+// Fast path failed: drop the static lease and go back to scan + DHCP
+static void fast_fallback(void)
+{
+    if (lease_reused)
+    {
+        esp_netif_dhcpc_start(sta_netif);
+        lease_reused = false;
+    }
+}
+
+static void remember_fast(const esp_netif_ip_info_t *ip_info)
+{
+    wifi_ap_record_t ap;
+    wifi_config_t cfg;
+    if (esp_wifi_sta_get_ap_info(&ap) != ESP_OK) return;
+    if (esp_wifi_get_config(WIFI_IF_STA, &cfg) != ESP_OK) return;
+
+    wifi_nvs_fast_t f;
+    memset(&f, 0, sizeof(f));
+    strncpy(f.ssid, (const char*)cfg.sta.ssid, sizeof(f.ssid) - 1);
+    memcpy(f.bssid, ap.bssid, sizeof(f.bssid));
+    f.channel = ap.primary;
+
+    if (ip_info)
+    {
+        f.ip = ip_info->ip.addr;
+        f.gw = ip_info->gw.addr;
+        f.netmask = ip_info->netmask.addr;
+    }
+
+    esp_netif_dns_info_t dns;
+    if (sta_netif && esp_netif_get_dns_info(sta_netif, ESP_NETIF_DNS_MAIN, &dns) == ESP_OK &&
+        dns.ip.type == ESP_IPADDR_TYPE_V4)
+    {
+        f.dns = dns.ip.u_addr.ip4.addr;
+    }
+
+    // Skip the flash write when nothing changed (the common case)
+    if (memcmp(&f, &fast_cache, sizeof(f)) == 0) return;
+
+    fast_cache = f;
+    if (!wifi_nvs_save_fast(&f)) ESP_LOGW(TAG, "Failed to store fast-connect info");
+}
+
+// Load known networks and pick the first move: fast path or scan
+static bool prepare_session(void)
+{
+    known_count = wifi_nvs_load_nets(known_nets, WIFI_NVS_MAX_NETS);
+    cand_count = 0;
+    cand_pos = 0;
+    lease_reused = false;
+
+    if (known_count == 0)
+    {
+        phase = PH_IDLE;
+        ESP_LOGI(TAG, "No WiFi creds in NVS yet");
+        return false;
+    }
+    phase = PH_SCANNING;
+
+    if (sta_netif) esp_netif_dhcpc_start(sta_netif);   // may have been stopped by a reused lease
+
+#if WIFI_FAST_CONNECT
+    if (wifi_nvs_load_fast(&fast_cache))
+    {
+        for (int k = 0; k < known_count; k++)
+        {
+            if (strcmp(known_nets[k].ssid, fast_cache.ssid) != 0) continue;
+
+            set_sta_target(&known_nets[k], fast_cache.bssid, fast_cache.channel);
+            phase = PH_FAST;
+#if WIFI_FAST_REUSE_LEASE
+            apply_cached_lease();
+#endif
+            break;
+        }
+    }
+#endif
+
+    ESP_LOGI(TAG, "Loaded %d WiFi network(s) from NVS (fast=%d, lease=%d)",
+             known_count, phase == PH_FAST, lease_reused);
+    return true;
+}
+
+/* ---------- Events ---------- */
 
 static void wifi_event_handler(void *arg,
                                esp_event_base_t event_base,
                                int32_t event_id,
                                void *event_data)
 {
-    (void)arg; (void)event_data;
+    (void)arg;
 
-    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
+    if (event_base == WIFI_EVENT)
     {
-        esp_wifi_connect();
+        uint32_t reason = 0;
+        if (event_id == WIFI_EVENT_STA_DISCONNECTED && event_data)
+            reason = ((wifi_event_sta_disconnected_t*)event_data)->reason;
+        TRACE(TR_WIFI_EVENT, event_id, reason);
+    }
+
+    if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_STOP)
+    {
+        sta_started = false;
+        scan_ours = false;
+    }
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START)
+    {
+        sta_started = true;
+        connect_start_us = esp_timer_get_time();
+        if (phase == PH_FAST) start_attempt();
+        else if (phase == PH_SCANNING) begin_scan();
+    }
+    else if (event_base == WIFI_MGR_EVENT && event_id == WIFI_MGR_EVENT_RETRY)
+    {
+        // Stale if a restart already scanned or connected since the timer fired
+        if (phase == PH_SCANNING && !scan_ours) begin_scan();
+    }
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_SCAN_DONE)
+    {
+        // The portal scans too; its records are left for it to read
+        if (!scan_ours) return;
+        scan_ours = false;
+        if (phase == PH_SCANNING) on_scan_done();
     }
     else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
     {
-        if (retry_count < MAX_WIFI_RETRY)
+        esp_timer_stop(attempt_timer);
+
+        if (phase == PH_FAST)
+        {
+            // Cached AP gone or moved channel: fall back to scan + ranking
+            ESP_LOGW(TAG, "Fast reconnect failed, falling back to full scan");
+            fast_fallback();
+            begin_scan();
+        }
+        else if (phase == PH_TRYING)
         {
-            retry_count++;
-            esp_wifi_connect();
-            ESP_LOGW(TAG, "Retrying WiFi (%d)", retry_count);
+            cand_pos++;
+            try_next_candidate();
         }
-        else
+        else if (phase == PH_CONNECTED)
         {
-            wifi_failed = true;
-            ESP_LOGE(TAG, "WiFi connection failed");
+            ESP_LOGW(TAG, "WiFi link lost");
+            wifi_connected = false;
+            stats.link_losses++;
+            retry_count = 0;
+            // A fast connect left DHCP stopped; the next AP needs a fresh lease
+            fast_fallback();
+            round_failed();
         }
     }
     else if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
     {
+        // Not ours (e.g. the provisioning portal's network test)
+        if (phase == PH_IDLE) return;
+
+        ip_event_got_ip_t *ev = (ip_event_got_ip_t*)event_data;
+        esp_timer_stop(attempt_timer);
+
+        last_connect_ms = (int)((esp_timer_get_time() - connect_start_us) / 1000);
+        last_was_fast = (phase == PH_FAST);
+        phase = PH_CONNECTED;
+
         wifi_connected = true;
         retry_count = 0;
-        ESP_LOGI(TAG, "WiFi connected, IP acquired");
+        stats.connects++;
+        TRACE(TR_WIFI_GOT_IP, last_connect_ms, last_was_fast);
+        ESP_LOGI(TAG, "WiFi connected to '%s', IP acquired in %d ms (%s%s)",
+                 cur_ssid, last_connect_ms,
+                 last_was_fast ? "fast" : "scan",
+                 lease_reused ? ", cached lease" : "");
+
+        wifi_nvs_mark_success(cur_ssid);
+        remember_fast(ev ? &ev->ip_info : NULL);
     }
 }
 
@@ -61,7 +480,7 @@ void wifi_manager_init(void)
 
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
-    esp_netif_create_default_wifi_sta();
+    sta_netif = esp_netif_create_default_wifi_sta();
 
     wifi_init_config_t cfg = WIFI_INIT_CONFIG_DEFAULT();
     ESP_ERROR_CHECK(esp_wifi_init(&cfg));
@@ -70,23 +489,23 @@ void wifi_manager_init(void)
         WIFI_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
     ESP_ERROR_CHECK(esp_event_handler_instance_register(
         IP_EVENT, IP_EVENT_STA_GOT_IP, &wifi_event_handler, NULL, NULL));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_MGR_EVENT, ESP_EVENT_ANY_ID, &wifi_event_handler, NULL, NULL));
 
-    // If creds exist in NVS, apply them to WiFi STA config now
-    char ssid[32], pass[64];
-    if (wifi_nvs_load_creds(ssid, sizeof(ssid), pass, sizeof(pass)))
-    {
-        wifi_config_t wifi_cfg = {0};
-        strncpy((char*)wifi_cfg.sta.ssid, ssid, sizeof(wifi_cfg.sta.ssid) - 1);
-        strncpy((char*)wifi_cfg.sta.password, pass, sizeof(wifi_cfg.sta.password) - 1);
+    esp_timer_create_args_t rargs = {
+        .callback = retry_timer_cb,
+        .name = "wifi_retry"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&rargs, &retry_timer));
 
-        ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
-        ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_STA, &wifi_cfg));
-        ESP_LOGI(TAG, "Loaded WiFi creds from NVS (ssid=%s)", ssid);
-    }
-    else
-    {
-        ESP_LOGI(TAG, "No WiFi creds in NVS yet");
-    }
+    esp_timer_create_args_t aargs = {
+        .callback = attempt_timer_cb,
+        .name = "wifi_attempt"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&aargs, &attempt_timer));
+
+    known_count = wifi_nvs_load_nets(known_nets, WIFI_NVS_MAX_NETS);
+    ESP_LOGI(TAG, "%d known WiFi network(s) in NVS", known_count);
 }
 
 bool wifi_credentials_available(void)
@@ -94,11 +513,51 @@ bool wifi_credentials_available(void)
     return wifi_nvs_has_creds();
 }
 
+// Provisioning saved a network, or changed a password, since the last load
+static bool creds_changed(void)
+{
+    wifi_nvs_net_t nets[WIFI_NVS_MAX_NETS];
+    int n = wifi_nvs_load_nets(nets, WIFI_NVS_MAX_NETS);
+    if (n != known_count) return true;
+
+    for (int i = 0; i < n; i++)
+    {
+        // Ranking fields move on every connect; only the credentials count
+        if (strcmp(nets[i].ssid, known_nets[i].ssid) != 0 ||
+            strcmp(nets[i].pass, known_nets[i].pass) != 0) return true;
+    }
+    return false;
+}
+
 void wifi_manager_start(void)
 {
+    // Already associated with nothing new to try: keep the link
+    if (phase == PH_CONNECTED && wifi_connected && !creds_changed())
+    {
+        ESP_LOGI(TAG, "WiFi already connected to '%s'", cur_ssid);
+        return;
+    }
+
     wifi_connected = false;
     wifi_failed = false;
     retry_count = 0;
+    esp_timer_stop(retry_timer);
+    esp_timer_stop(attempt_timer);
+
+    // Re-read networks: provisioning may have added one since init
+    prepare_session();
+
+    connect_start_us = esp_timer_get_time();
+
+    if (sta_started)
+    {
+        // Provisioning handoff: driver already up in APSTA. Keep the mode
+        // (the portal is still serving) and connect without a restart.
+        ESP_LOGI(TAG, "WiFi already running, connecting without restart");
+        if (phase == PH_FAST) start_attempt();
+        else if (phase == PH_SCANNING) begin_scan();
+        return;
+    }
 
     ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_STA));
     ESP_ERROR_CHECK(esp_wifi_start());
@@ -107,3 +566,14 @@ void wifi_manager_start(void)
 
 bool wifi_is_connected(void) { return wifi_connected; }
 bool wifi_has_failed(void) { return wifi_failed; }
+
+int wifi_get_last_connect_ms(void) { return last_connect_ms; }
+bool wifi_last_connect_was_fast(void) { return last_was_fast; }
+
+void wifi_get_stats(wifi_stats_t *out)
+{
+    if (!out) return;
+    *out = stats;
+    out->connected = wifi_connected;
+    out->last_connect_ms = last_connect_ms;
+}
@@ -2,6 +2,17 @@
 #define WIFI_MANAGER_H
 
 #include <stdbool.h>
+#include <stdint.h>
+
+// Counters since boot
+typedef struct {
+    uint32_t connects;        // IP acquired
+    uint32_t retries;         // backoff rounds after all candidates failed
+    uint32_t failures;        // gave up (wifi_has_failed)
+    uint32_t link_losses;     // disconnected while connected
+    bool connected;
+    int last_connect_ms;      // -1 = none yet
+} wifi_stats_t;
 
 void wifi_manager_init(void);
 void wifi_manager_start(void);
@@ -10,4 +21,10 @@ bool wifi_credentials_available(void);
 bool wifi_is_connected(void);
 bool wifi_has_failed(void);
 
+// Time from STA start to IP of the last successful connect (-1 = none yet)
+int wifi_get_last_connect_ms(void);
+bool wifi_last_connect_was_fast(void);
+
+void wifi_get_stats(wifi_stats_t *out);
+
 #endif
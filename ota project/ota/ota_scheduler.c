@@ -0,0 +1,327 @@
+#include "ota_scheduler.h"
+#include "ota_manager.h"
+#include "config/ota_config.h"
+#include "manifest/manifest_client.h"
+#include "network/wifi_manager.h"
+#include "network/server_backoff.h"
+#include "ota_update/ota_update_manager.h"
+#include "ota_update/ota_prefetch.h"
+#include "storage/mem_monitor.h"
+#include "storage/nvs_stats.h"
+
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_mac.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include <string.h>
+
+#define SCHED_NVS_NS    "ota_sched"
+#define SCHED_NVS_KEY   "next"      // blob: sched_rec_t
+#define SCHED_VERSION   1
+
+static const char *TAG = "ota_sched";
+
+// Remaining delay rather than a wall-clock time: there is no RTC time
+// before (or without) SNTP, but uptime deltas are always valid
+typedef struct {
+    uint8_t version;
+    uint8_t fails;
+    uint16_t reserved;
+    uint32_t remaining_s;
+} sched_rec_t;
+
+typedef enum {
+    SCHED_WAIT = 0,
+    SCHED_CONNECTING,       // background STA connect for the check
+    SCHED_FETCHING          // check_task running
+} sched_phase_t;
+
+typedef enum {
+    CHECK_RUNNING = 0,
+    CHECK_FAILED,
+    CHECK_BUSY,             // server asked us to wait
+    CHECK_NO_UPDATE,
+    CHECK_UPDATE
+} check_result_t;
+
+static sched_phase_t g_phase = SCHED_WAIT;
+static int64_t g_due_us = 0;
+static int64_t g_saved_us = 0;      // last countdown save
+static uint8_t g_fails = 0;
+static uint32_t g_rng = 0;
+static volatile check_result_t g_result = CHECK_RUNNING;
+static ota_manifest_t g_mf;         // check_task only
+
+/* ---------- Jitter ---------- */
+
+// xorshift32 seeded from the STA MAC: devices that power up together
+// still draw different delays
+static uint32_t rng_next(void)
+{
+    uint32_t x = g_rng;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    g_rng = x;
+    return x;
+}
+
+static void rng_seed(void)
+{
+    uint8_t mac[6] = {0};
+    esp_read_mac(mac, ESP_MAC_WIFI_STA);
+
+    uint32_t h = 2166136261u;   // FNV-1a
+    for (int i = 0; i < 6; i++)
+    {
+        h ^= mac[i];
+        h *= 16777619u;
+    }
+    g_rng = h ? h : 1;
+}
+
+// Uniform in [lo, hi]
+static uint32_t rand_between(uint32_t lo, uint32_t hi)
+{
+    if (hi <= lo) return lo;
+    return lo + rng_next() % (hi - lo + 1);
+}
+
+static uint32_t interval_with_jitter(void)
+{
+    uint32_t j = (uint32_t)((uint64_t)OTA_SCHED_INTERVAL_S * OTA_SCHED_JITTER_PCT / 100);
+    return rand_between(OTA_SCHED_INTERVAL_S - j, OTA_SCHED_INTERVAL_S + j);
+}
+
+// base * 2^(fails-1), capped; drawn from the upper half so retries spread out
+static uint32_t backoff_s(uint8_t fails)
+{
+    uint32_t d = OTA_SCHED_RETRY_BASE_S;
+    for (int i = 1; i < fails && d < OTA_SCHED_RETRY_MAX_S; i++) d *= 2;
+    if (d > OTA_SCHED_RETRY_MAX_S) d = OTA_SCHED_RETRY_MAX_S;
+    return rand_between(d / 2, d);
+}
+
+/* ---------- Persistence ---------- */
+
+static uint32_t remaining_s(void)
+{
+    int64_t left = g_due_us - esp_timer_get_time();
+    return (left > 0) ? (uint32_t)(left / 1000000) : 0;
+}
+
+static void save(void)
+{
+    sched_rec_t r = {
+        .version = SCHED_VERSION,
+        .fails = g_fails,
+        .remaining_s = remaining_s()
+    };
+
+    nvs_handle_t h;
+    if (nvs_open(SCHED_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return;
+    nvs_set_blob(h, SCHED_NVS_KEY, &r, sizeof(r));
+    nvs_stats_commit(h);
+    nvs_close(h);
+
+    g_saved_us = esp_timer_get_time();
+}
+
+static bool load(sched_rec_t *r)
+{
+    nvs_handle_t h;
+    if (nvs_open(SCHED_NVS_NS, NVS_READONLY, &h) != ESP_OK) return false;
+
+    size_t sz = sizeof(*r);
+    esp_err_t e = nvs_get_blob(h, SCHED_NVS_KEY, r, &sz);
+    nvs_close(h);
+    return e == ESP_OK && sz == sizeof(*r) && r->version == SCHED_VERSION;
+}
+
+static void schedule_in(uint32_t s)
+{
+    g_due_us = esp_timer_get_time() + (int64_t)s * 1000000;
+    g_phase = SCHED_WAIT;
+    save();
+    ESP_LOGI(TAG, "next check in %lu s (fails %u)", (unsigned long)s, g_fails);
+}
+
+// Honor the server's wait, spread by the usual jitter so the fleet
+// doesn't come back in the same second
+static void schedule_after_busy(void)
+{
+    uint32_t s = server_backoff_remaining_s();
+    schedule_in(rand_between(s, s + s * OTA_SCHED_JITTER_PCT / 100 + 1));
+}
+
+static void check_done(bool ok)
+{
+    if (ok)
+    {
+        g_fails = 0;
+        schedule_in(interval_with_jitter());
+    }
+    else
+    {
+        if (g_fails < 255) g_fails++;
+        schedule_in(backoff_s(g_fails));
+    }
+}
+
+/* ---------- Check ---------- */
+
+static void check_task(void *arg)
+{
+    (void)arg;
+    mem_monitor_task_enter(OTA_SCHED_TASK_STACK);
+
+    char err[64];
+    if (!ota_prefetch_manifest(&g_mf, err, sizeof(err)))
+    {
+        ESP_LOGW(TAG, "check failed: %s", err);
+        g_result = server_backoff_remaining_s() > 0 ? CHECK_BUSY : CHECK_FAILED;
+    }
+    else if (ota_update_version_is_newer(g_mf.version) && !manifest_in_rollout(&g_mf))
+    {
+        ESP_LOGI(TAG, "%s not in this device's wave (bucket %u, wave %u%%)",
+                 g_mf.version, manifest_rollout_bucket(&g_mf), g_mf.rollout_pct);
+        g_result = CHECK_NO_UPDATE;
+    }
+    else
+    {
+        g_result = ota_update_version_is_newer(g_mf.version) ? CHECK_UPDATE : CHECK_NO_UPDATE;
+    }
+
+    mem_monitor_task_exit();
+    vTaskDelete(NULL);
+}
+
+static void start_check(void)
+{
+    g_result = CHECK_RUNNING;
+    g_phase = SCHED_FETCHING;
+    if (xTaskCreate(check_task, "ota_check", OTA_SCHED_TASK_STACK, NULL, 3, NULL) != pdPASS)
+    {
+        ESP_LOGE(TAG, "check task create failed");
+        check_done(false);
+    }
+}
+
+// A user-started session owns WiFi and the LCD
+static bool session_busy(void)
+{
+    ota_state_t st = ota_get_state();
+    return (st != OTA_STATE_IDLE && st != OTA_STATE_SUCCESS && st != OTA_STATE_FAILED) ||
+           ota_update_is_running();
+}
+
+/* ---------- Public API ---------- */
+
+void ota_scheduler_init(void)
+{
+    if (!OTA_SCHED_ENABLE) return;
+    rng_seed();
+
+    sched_rec_t r;
+    uint32_t first;
+    if (load(&r))
+    {
+        // Up to one save period may have run before the reboot; assume it
+        // all did, or a device rebooting more often than that would keep
+        // restoring (and re-saving) the same countdown forever
+        g_fails = r.fails;
+        first = r.remaining_s > OTA_SCHED_SAVE_S ? r.remaining_s - OTA_SCHED_SAVE_S : 0;
+    }
+    else
+    {
+        // First boot: anywhere in one interval, so a fleet flashed or
+        // powered together doesn't check together
+        first = rand_between(OTA_SCHED_MIN_DELAY_S, OTA_SCHED_INTERVAL_S);
+    }
+
+    // A countdown that ran out while powered off still waits a little,
+    // so a power restoration doesn't line every device up on boot
+    if (first < OTA_SCHED_MIN_DELAY_S) first = rand_between(OTA_SCHED_MIN_DELAY_S, 2 * OTA_SCHED_MIN_DELAY_S);
+
+    schedule_in(first);
+}
+
+void ota_scheduler_process(void)
+{
+    if (!OTA_SCHED_ENABLE) return;
+
+    int64_t now = esp_timer_get_time();
+
+    switch (g_phase)
+    {
+        case SCHED_WAIT:
+            if (now < g_due_us)
+            {
+                if (now - g_saved_us >= (int64_t)OTA_SCHED_SAVE_S * 1000000) save();
+                return;
+            }
+            if (session_busy())
+            {
+                schedule_in(backoff_s(1));  // try again shortly, not a failure
+                return;
+            }
+            if (server_backoff_remaining_s() > 0)
+            {
+                schedule_after_busy();
+                return;
+            }
+            if (!wifi_credentials_available())
+            {
+                check_done(true);           // nothing to connect with yet
+                return;
+            }
+            if (wifi_is_connected())
+            {
+                start_check();
+                return;
+            }
+            ESP_LOGI(TAG, "connecting for update check");
+            g_phase = SCHED_CONNECTING;
+            wifi_manager_start();
+            return;
+
+        case SCHED_CONNECTING:
+            if (session_busy())
+            {
+                schedule_in(backoff_s(1));  // the session restarts WiFi itself
+                return;
+            }
+            if (wifi_is_connected()) start_check();
+            else if (wifi_has_failed()) check_done(false);
+            return;
+
+        case SCHED_FETCHING:
+            if (g_result == CHECK_RUNNING) return;
+
+            if (g_result == CHECK_UPDATE && !session_busy())
+            {
+                ESP_LOGI(TAG, "update %s found", g_mf.version);
+                ota_set_state(OTA_STATE_FETCHING_MANIFEST);   // WiFi is already up
+            }
+            if (g_result == CHECK_BUSY) schedule_after_busy();
+            else check_done(g_result != CHECK_FAILED);
+            return;
+    }
+}
+
+uint32_t ota_scheduler_next_check_s(void)
+{
+    return remaining_s();
+}
+
+uint8_t ota_scheduler_fail_count(void)
+{
+    return g_fails;
+}
+
+bool ota_scheduler_is_connecting(void)
+{
+    return g_phase == SCHED_CONNECTING;
+}
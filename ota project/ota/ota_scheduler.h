@@ -0,0 +1,23 @@
+#ifndef OTA_SCHEDULER_H
+#define OTA_SCHEDULER_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+// Background update checks: every OTA_SCHED_INTERVAL_S with per-device
+// jitter, exponential backoff after failures. The countdown survives reboots.
+// A newer version hands over to the state machine (FETCHING_MANIFEST).
+
+void ota_scheduler_init(void);
+
+// Call from the main loop next to ota_state_machine_process()
+void ota_scheduler_process(void);
+
+// Seconds until the next check, failures in a row
+uint32_t ota_scheduler_next_check_s(void);
+uint8_t ota_scheduler_fail_count(void);
+
+// True while a background check waits for the STA to come up
+bool ota_scheduler_is_connecting(void);
+
+#endif
@@ -3,135 +3,369 @@
 #include "ota_states.h"
 
 #include "ui/lcd_ui.h"
+#include "ui/buzzer.h"
 #include "network/wifi_manager.h"
 #include "provisioning/provisioning_manager.h"
 #include "ota_update/ota_update_manager.h"
 #include "storage/ota_diag.h"
+#include "storage/mem_monitor.h"
+#include "storage/trace.h"
 
+#include "esp_log.h"
+#include "esp_timer.h"
 #include <stdio.h>
 
-static bool s_prov_started = false;
-static bool s_wifi_started = false;
-static bool s_ota_started  = false;
+#define RESULT_MSG_MS       2000    // "Update OK" etc. before the steady screen
+#define MAX_STEPS_PER_POLL  4       // update phases can advance several states at once
 
-static void reset_session_flags(void)
+static const char *TAG = "ota_sm";
+
+static ota_state_t s_active = OTA_STATE_IDLE;   // state whose entry action has run
+static int64_t s_entered_us = 0;
+static bool s_handoff = false;   // STA connecting while the portal AP is still up
+static bool s_outside = false;   // current move was set via ota_set_state, not a table row
+static int s_last_percent = -1;
+
+static ota_sm_trace_t s_trace[OTA_SM_TRACE_LEN];
+static int s_trace_head = 0;     // next slot
+static int s_trace_count = 0;
+
+/* ---------- Guards ---------- */
+
+static bool always(void)            { return true; }
+static bool have_creds(void)        { return wifi_credentials_available(); }
+static bool prov_done(void)         { return provisioning_is_done(); }
+static bool prov_failed(void)       { return provisioning_has_failed(); }
+static bool wifi_up(void)           { return wifi_is_connected(); }
+static bool handoff_failed(void)    { return s_handoff && wifi_has_failed(); }
+static bool wifi_failed(void)       { return wifi_has_failed(); }
+
+static bool upd_no_update(void)     { return ota_update_get_info().status == OTA_UPD_NO_UPDATE; }
+static bool upd_failed(void)        { return ota_update_get_info().status == OTA_UPD_FAILED; }
+static bool upd_success(void)       { return ota_update_get_info().status == OTA_UPD_SUCCESS; }
+static bool upd_downloading(void)   { return ota_update_get_info().phase >= OTA_PHASE_DOWNLOAD; }
+static bool upd_verifying(void)     { return ota_update_get_info().phase >= OTA_PHASE_VERIFY; }
+static bool upd_installing(void)    { return ota_update_get_info().phase >= OTA_PHASE_INSTALL; }
+
+/* ---------- Transition actions ---------- */
+
+// Beep code class: 1 network, 2 bad image, 3 flash/boot
+static uint8_t error_beep_class(ota_update_error_t err)
 {
-    s_prov_started = false;
-    s_wifi_started = false;
-    s_ota_started  = false;
+    switch (err)
+    {
+        case OTA_ERR_MANIFEST_FETCH:
+        case OTA_ERR_HTTP_OPEN:
+        case OTA_ERR_HTTP_READ:
+        case OTA_ERR_SERVER_BUSY:
+            return 1;
+        case OTA_ERR_MANIFEST_PARSE:
+        case OTA_ERR_SIZE_MISMATCH:
+        case OTA_ERR_SHA256_MISMATCH:
+        case OTA_ERR_DECRYPT:
+            return 2;
+        default:
+            return 3;
+    }
 }
 
-void ota_state_machine_process(void)
+static void start_handoff(void)
+{
+    // Keep the AP/portal up; the STA connects alongside it
+    provisioning_begin_handoff();
+    s_handoff = true;
+}
+
+static void stop_portal(void)
+{
+    provisioning_stop();
+}
+
+static void release_portal(void)
+{
+    if (s_handoff)
+    {
+        provisioning_release_ap();
+        s_handoff = false;
+    }
+    lcd_show_message_for("WiFi Connected", RESULT_MSG_MS);
+}
+
+static void show_wifi_failed(void)
+{
+    lcd_show_message("WiFi Failed");
+}
+
+static void show_wifi_retry(void)
+{
+    lcd_show_message_for("WiFi Failed", RESULT_MSG_MS);
+}
+
+static void show_no_update(void)
+{
+    lcd_show_message_for("No Update", RESULT_MSG_MS);
+}
+
+static void show_update_ok(void)
+{
+    lcd_show_message_for("Update OK", RESULT_MSG_MS);   // reboot happens in update manager
+    buzzer_success();
+}
+
+static void show_update_failed(void)
 {
     ota_update_info_t upd = ota_update_get_info();
+    char msg[21];
+    snprintf(msg, sizeof(msg), "Fail: %s", ota_diag_error_short_str((uint16_t)upd.error));
+    lcd_show_message(msg);
+    buzzer_error_code(error_beep_class(upd.error));
+}
 
-    switch (ota_get_state())
+/* ---------- Entry / exit actions ---------- */
+
+static void enter_checking_wifi(void)
+{
+    s_handoff = false;
+    lcd_show_message("Checking WiFi");
+}
+
+static void enter_provisioning(void)
+{
+    lcd_show_message("Setup WiFi");
+    if (s_handoff)
     {
-        case OTA_STATE_IDLE:
-            reset_session_flags();
-            break;
-
-        case OTA_STATE_CHECKING_WIFI:
-            lcd_show_message("Checking WiFi");
-            if (wifi_credentials_available())
-                ota_set_state(OTA_STATE_CONNECTING);
-            else
-                ota_set_state(OTA_STATE_PROVISIONING);
-            break;
-
-        case OTA_STATE_PROVISIONING:
-            lcd_show_message("Setup WiFi");
-            if (!s_prov_started)
-            {
-                provisioning_start();
-                s_prov_started = true;
-            }
+        // Portal is still up: let the user fix the credentials
+        provisioning_resume();
+        s_handoff = false;
+    }
+    else
+    {
+        provisioning_start();
+    }
+}
 
-            if (provisioning_is_done())
-            {
-                provisioning_stop();
-                s_prov_started = false;
-                ota_set_state(OTA_STATE_CONNECTING);
-            }
-            else if (provisioning_has_failed())
-            {
-                provisioning_stop();
-                s_prov_started = false;
-                ota_set_state(OTA_STATE_FAILED);
-            }
-            break;
+// The table rows decide what happens to the portal (handoff or stop); a move
+// set from outside would leave it running with nobody to release it
+static void exit_provisioning(void)
+{
+    if (s_outside) provisioning_stop();
+}
 
-        case OTA_STATE_CONNECTING:
-            lcd_show_message("Connecting WiFi");
-            if (!s_wifi_started)
-            {
-                wifi_manager_start();
-                s_wifi_started = true;
-            }
-            ota_set_state(OTA_STATE_FETCHING_MANIFEST);
-            break;
+static void enter_connecting(void)
+{
+    lcd_show_message("Connecting WiFi");
+    wifi_manager_start();
+}
 
-        case OTA_STATE_FETCHING_MANIFEST:
-            if (wifi_is_connected())
-            {
-                lcd_show_message("WiFi Connected");
-                ota_set_state(OTA_STATE_DOWNLOADING);
-            }
-            else if (wifi_has_failed())
-            {
-                lcd_show_message("WiFi Failed");
-                ota_set_state(OTA_STATE_FAILED);
-            }
-            else
-            {
-                lcd_show_message("WiFi Connecting");
-            }
-            break;
+static void exit_connecting(void)
+{
+    if (s_outside && s_handoff)
+    {
+        provisioning_release_ap();
+        s_handoff = false;
+    }
+}
 
-        case OTA_STATE_DOWNLOADING:
-            if (!s_ota_started)
-            {
-                lcd_show_progress_bar(0, "Downloading");
-                ota_update_start();
-                s_ota_started = true;
-                break;
-            }
+static void enter_fetching_manifest(void)
+{
+    lcd_show_message("Checking Update");
+    ota_update_start();
+}
+
+static void enter_downloading(void)
+{
+    s_last_percent = -1;
+}
+
+static void during_downloading(void)
+{
+    int pct = ota_update_get_info().progress_percent;
+    if (pct != s_last_percent)
+    {
+        s_last_percent = pct;
+        lcd_show_progress_bar(pct, "Downloading");
+    }
+}
+
+static void exit_downloading(void)
+{
+    ota_update_info_t upd = ota_update_get_info();
+    ESP_LOGI(TAG, "download: %d bytes in %lu ms", upd.bytes_written,
+             (unsigned long)((esp_timer_get_time() - s_entered_us) / 1000));
+}
+
+static void enter_verifying(void)
+{
+    lcd_show_message("Verifying");
+}
+
+static void enter_installing(void)
+{
+    lcd_show_message("Installing");
+}
+
+static void enter_success(void)
+{
+    lcd_show_message("OTA Ready");
+}
 
-            if (upd.status == OTA_UPD_RUNNING)
+/* ---------- Tables ---------- */
+
+typedef struct {
+    const char *name;
+    void (*on_enter)(void);
+    void (*on_exit)(void);
+    void (*during)(void);       // every poll while active; keep it cheap
+} state_def_t;
+
+static const state_def_t k_states[] = {
+    [OTA_STATE_IDLE]              = { "IDLE",              NULL,                    NULL,              NULL },
+    [OTA_STATE_CHECKING_WIFI]     = { "CHECKING_WIFI",     enter_checking_wifi,     NULL,              NULL },
+    [OTA_STATE_PROVISIONING]      = { "PROVISIONING",      enter_provisioning,      exit_provisioning, NULL },
+    [OTA_STATE_CONNECTING]        = { "CONNECTING",        enter_connecting,        exit_connecting,   NULL },
+    [OTA_STATE_FETCHING_MANIFEST] = { "FETCHING_MANIFEST", enter_fetching_manifest, NULL,              NULL },
+    [OTA_STATE_DOWNLOADING]       = { "DOWNLOADING",       enter_downloading,       exit_downloading,  during_downloading },
+    [OTA_STATE_VERIFYING]         = { "VERIFYING",         enter_verifying,         NULL,              NULL },
+    [OTA_STATE_INSTALLING]        = { "INSTALLING",        enter_installing,        NULL,              NULL },
+    [OTA_STATE_SUCCESS]           = { "SUCCESS",           enter_success,           NULL,              NULL },
+    [OTA_STATE_FAILED]            = { "FAILED",            NULL,                    NULL,              NULL },   // keep last message on LCD
+};
+
+#define STATE_COUNT ((int)(sizeof(k_states) / sizeof(k_states[0])))
+
+typedef struct {
+    ota_state_t from;
+    bool (*when)(void);
+    void (*action)(void);       // runs between exit of "from" and entry of "to"
+    ota_state_t to;
+} transition_t;
+
+// First matching row wins, so order rows by priority within a state
+static const transition_t k_transitions[] = {
+    { OTA_STATE_CHECKING_WIFI,     have_creds,      NULL,               OTA_STATE_CONNECTING },
+    { OTA_STATE_CHECKING_WIFI,     always,          NULL,               OTA_STATE_PROVISIONING },
+
+    { OTA_STATE_PROVISIONING,      prov_done,       start_handoff,      OTA_STATE_CONNECTING },
+    { OTA_STATE_PROVISIONING,      prov_failed,     stop_portal,        OTA_STATE_FAILED },
+
+    { OTA_STATE_CONNECTING,        wifi_up,         release_portal,     OTA_STATE_FETCHING_MANIFEST },
+    { OTA_STATE_CONNECTING,        handoff_failed,  show_wifi_retry,    OTA_STATE_PROVISIONING },
+    { OTA_STATE_CONNECTING,        wifi_failed,     show_wifi_failed,   OTA_STATE_FAILED },
+
+    { OTA_STATE_FETCHING_MANIFEST, upd_failed,      show_update_failed, OTA_STATE_FAILED },
+    { OTA_STATE_FETCHING_MANIFEST, upd_no_update,   show_no_update,     OTA_STATE_SUCCESS },
+    { OTA_STATE_FETCHING_MANIFEST, upd_downloading, NULL,               OTA_STATE_DOWNLOADING },
+
+    { OTA_STATE_DOWNLOADING,       upd_failed,      show_update_failed, OTA_STATE_FAILED },
+    { OTA_STATE_DOWNLOADING,       upd_verifying,   NULL,               OTA_STATE_VERIFYING },
+
+    { OTA_STATE_VERIFYING,         upd_failed,      show_update_failed, OTA_STATE_FAILED },
+    { OTA_STATE_VERIFYING,         upd_installing,  NULL,               OTA_STATE_INSTALLING },
+
+    { OTA_STATE_INSTALLING,        upd_failed,      show_update_failed, OTA_STATE_FAILED },
+    { OTA_STATE_INSTALLING,        upd_success,     show_update_ok,     OTA_STATE_SUCCESS },
+};
+
+/* ---------- Trace ---------- */
+
+static void trace_record(ota_state_t from, ota_state_t to, int64_t now_us)
+{
+    ota_sm_trace_t *t = &s_trace[s_trace_head];
+    t->time_ms = (uint32_t)(now_us / 1000);
+    t->dwell_ms = (uint32_t)((now_us - s_entered_us) / 1000);
+    t->from = (uint8_t)from;
+    t->to = (uint8_t)to;
+
+    s_trace_head = (s_trace_head + 1) % OTA_SM_TRACE_LEN;
+    if (s_trace_count < OTA_SM_TRACE_LEN) s_trace_count++;
+}
+
+static void trace_dump(void)
+{
+    ota_sm_trace_t t[OTA_SM_TRACE_LEN];
+    int n = ota_state_machine_get_trace(t, OTA_SM_TRACE_LEN);
+    for (int i = 0; i < n; i++)
+    {
+        ESP_LOGI(TAG, "%8lu ms  %-17s -> %-17s (%lu ms)",
+                 (unsigned long)t[i].time_ms, ota_state_name((ota_state_t)t[i].from),
+                 ota_state_name((ota_state_t)t[i].to), (unsigned long)t[i].dwell_ms);
+    }
+}
+
+/* ---------- Engine ---------- */
+
+static void switch_to(ota_state_t to, void (*action)(void))
+{
+    ota_state_t from = s_active;
+    int64_t now = esp_timer_get_time();
+
+    if (k_states[from].on_exit) k_states[from].on_exit();
+    if (action) action();
+
+    trace_record(from, to, now);
+    TRACE(TR_STATE, from, to);
+    s_active = to;
+    s_entered_us = now;
+    ota_set_state(to);
+
+    mem_monitor_sample(k_states[to].name);
+
+    if (k_states[to].on_enter) k_states[to].on_enter();
+    if (to == OTA_STATE_SUCCESS || to == OTA_STATE_FAILED)
+    {
+        trace_dump();
+        mem_monitor_log();
+        mem_monitor_save();
+    }
+}
+
+void ota_state_machine_process(void)
+{
+    ota_state_t st = ota_get_state();
+    if ((int)st >= STATE_COUNT)
+    {
+        ota_set_state(OTA_STATE_FAILED);
+        st = OTA_STATE_FAILED;
+    }
+
+    // Set from outside (button trigger, scheduler): run it through exit/entry
+    // as well; the exit actions tear down what no table row will
+    if (st != s_active)
+    {
+        s_outside = true;
+        switch_to(st, NULL);
+        s_outside = false;
+    }
+
+    for (int step = 0; step < MAX_STEPS_PER_POLL; step++)
+    {
+        const transition_t *hit = NULL;
+        for (size_t i = 0; i < sizeof(k_transitions) / sizeof(k_transitions[0]); i++)
+        {
+            if (k_transitions[i].from == s_active && k_transitions[i].when())
             {
-                lcd_show_progress_bar(upd.progress_percent, "Downloading");
+                hit = &k_transitions[i];
                 break;
             }
+        }
+        if (!hit) break;
+        switch_to(hit->to, hit->action);
+    }
 
-            if (upd.status == OTA_UPD_NO_UPDATE)
-            {
-                lcd_show_message("No Update");
-                ota_set_state(OTA_STATE_SUCCESS);
-            }
-            else if (upd.status == OTA_UPD_SUCCESS)
-            {
-                lcd_show_message("Update OK");
-                ota_set_state(OTA_STATE_SUCCESS); // reboot happens in update manager
-            }
-            else if (upd.status == OTA_UPD_FAILED)
-            {
-                char msg[21];
-                snprintf(msg, sizeof(msg), "Fail: %s", ota_diag_error_short_str((uint16_t)upd.error));
-                lcd_show_message(msg);
-                ota_set_state(OTA_STATE_FAILED);
-            }
-            break;
+    if (k_states[s_active].during) k_states[s_active].during();
+}
 
-        case OTA_STATE_SUCCESS:
-            lcd_show_message("OTA Ready");
-            break;
+const char *ota_state_name(ota_state_t s)
+{
+    return ((int)s < STATE_COUNT) ? k_states[s].name : "?";
+}
 
-        case OTA_STATE_FAILED:
-            // keep last message on LCD
-            break;
+int ota_state_machine_get_trace(ota_sm_trace_t *out, int max)
+{
+    if (!out || max <= 0) return 0;
 
-        default:
-            ota_set_state(OTA_STATE_FAILED);
-            break;
-    }
+    int n = (s_trace_count < max) ? s_trace_count : max;
+    int start = (s_trace_head - n + OTA_SM_TRACE_LEN) % OTA_SM_TRACE_LEN;
+    for (int i = 0; i < n; i++) out[i] = s_trace[(start + i) % OTA_SM_TRACE_LEN];
+    return n;
 }
@@ -1,6 +1,23 @@
 #ifndef OTA_STATE_MACHINE_H
 #define OTA_STATE_MACHINE_H
 
+#include <stdint.h>
+#include "ota_states.h"
+
+#define OTA_SM_TRACE_LEN  16
+
+// One transition; dwell_ms is the time spent in "from"
+typedef struct {
+    uint32_t time_ms;       // since boot
+    uint32_t dwell_ms;
+    uint8_t from;           // ota_state_t
+    uint8_t to;
+} ota_sm_trace_t;
+
 void ota_state_machine_process(void);
 
+// Oldest first; returns count
+int ota_state_machine_get_trace(ota_sm_trace_t *out, int max);
+const char *ota_state_name(ota_state_t s);
+
 #endif
@@ -0,0 +1,185 @@
+#include "flash_verify.h"
+#include "security/sha256_util.h"
+#include "storage/mem_monitor.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define VERIFY_CHUNK        SPI_FLASH_SEC_SIZE
+#define VERIFY_TASK_STACK   3072
+#define VERIFY_TASK_PRIO    4       // below ota_stream_task: runs while it waits on the network
+#define VERIFY_FINISH_MS    30000
+
+static const char *TAG = "FLASH_VERIFY";
+
+static const esp_partition_t *g_part = NULL;
+static TaskHandle_t g_task = NULL;
+static SemaphoreHandle_t g_done = NULL;     // given once by the task on exit
+
+// Writer -> verifier progress, guarded by g_mux
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+static size_t g_avail = 0;                  // bytes safe to read back
+static bool g_final = false;                // g_avail is the whole image
+static bool g_abort = false;
+
+// Results, read after g_done
+static bool g_ok = false;
+static uint8_t g_hash[32];
+static size_t g_verified = 0;
+static int64_t g_busy_us = 0;
+
+static void verify_task(void *arg)
+{
+    (void)arg;
+    mem_monitor_task_enter(VERIFY_TASK_STACK);
+
+    uint8_t *buf = malloc(VERIFY_CHUNK);
+    sha256_ctx_t sha;
+    sha256_init(&sha);
+
+    size_t off = 0;
+    g_ok = (buf != NULL);
+
+    while (g_ok)
+    {
+        portENTER_CRITICAL(&g_mux);
+        bool final = g_final;
+        bool abort = g_abort;
+        size_t avail = g_avail;
+        portEXIT_CRITICAL(&g_mux);
+
+        if (abort) { g_ok = false; break; }
+        if (off >= avail)
+        {
+            if (final) break;
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(100));
+            continue;
+        }
+
+        size_t n = avail - off;
+        if (n > VERIFY_CHUNK) n = VERIFY_CHUNK;
+
+        int64_t t0 = esp_timer_get_time();
+        if (esp_partition_read(g_part, off, buf, n) != ESP_OK)
+        {
+            ESP_LOGE(TAG, "read back failed at 0x%x", (unsigned)off);
+            g_ok = false;
+            break;
+        }
+        sha256_update(&sha, buf, n);
+        g_busy_us += esp_timer_get_time() - t0;
+        off += n;
+    }
+
+    sha256_final(&sha, g_hash);
+    sha256_free(&sha);
+    free(buf);
+    g_verified = off;
+
+    mem_monitor_task_exit();
+    xSemaphoreGive(g_done);
+    vTaskDelete(NULL);
+}
+
+bool flash_verify_start(const esp_partition_t *part)
+{
+    if (!part || g_task) return false;
+
+    if (!g_done) g_done = xSemaphoreCreateBinary();
+    if (!g_done) return false;
+    (void)xSemaphoreTake(g_done, 0);
+
+    g_part = part;
+    g_avail = 0;
+    g_final = false;
+    g_abort = false;
+    g_ok = false;
+    g_verified = 0;
+    g_busy_us = 0;
+
+    if (xTaskCreate(verify_task, "ota_verify", VERIFY_TASK_STACK, NULL, VERIFY_TASK_PRIO, &g_task) != pdPASS)
+    {
+        g_task = NULL;
+        return false;
+    }
+    return true;
+}
+
+void flash_verify_written(size_t total_written)
+{
+    if (!g_task) return;
+
+    // Whole sectors only; the writer may still hold a partial block
+    size_t avail = total_written - (total_written % VERIFY_CHUNK);
+
+    bool more = false;
+    portENTER_CRITICAL(&g_mux);
+    if (avail > g_avail)
+    {
+        g_avail = avail;
+        more = true;
+    }
+    portEXIT_CRITICAL(&g_mux);
+
+    if (more) xTaskNotifyGive(g_task);
+}
+
+static bool wait_done(TickType_t ticks)
+{
+    bool done = (xSemaphoreTake(g_done, ticks) == pdTRUE);
+    if (done) g_task = NULL;
+    return done;
+}
+
+// The task checks g_abort between sector reads, so this returns within one
+// read; g_task is cleared for the next flash_verify_start
+static void stop_task(void)
+{
+    portENTER_CRITICAL(&g_mux);
+    g_abort = true;
+    portEXIT_CRITICAL(&g_mux);
+    xTaskNotifyGive(g_task);
+
+    (void)wait_done(portMAX_DELAY);
+}
+
+bool flash_verify_finish(size_t total, uint8_t out32[32], flash_verify_stats_t *stats)
+{
+    if (!g_task) return false;
+
+    int64_t t0 = esp_timer_get_time();
+
+    portENTER_CRITICAL(&g_mux);
+    g_avail = total;
+    g_final = true;
+    portEXIT_CRITICAL(&g_mux);
+    xTaskNotifyGive(g_task);
+
+    if (!wait_done(pdMS_TO_TICKS(VERIFY_FINISH_MS)))
+    {
+        ESP_LOGE(TAG, "verify task did not finish, stopping it");
+        stop_task();
+        return false;
+    }
+
+    if (stats)
+    {
+        stats->busy_ms = (uint32_t)(g_busy_us / 1000);
+        stats->wait_ms = (uint32_t)((esp_timer_get_time() - t0) / 1000);
+        stats->bytes = (uint32_t)g_verified;
+    }
+    if (out32) memcpy(out32, g_hash, 32);
+
+    return g_ok && g_verified == total;
+}
+
+void flash_verify_abort(void)
+{
+    if (!g_task) return;
+    stop_task();
+}
@@ -0,0 +1,29 @@
+#ifndef FLASH_VERIFY_H
+#define FLASH_VERIFY_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_partition.h"
+
+// Background read-back of a partition while it is being written: sectors
+// are read and hashed as soon as the writer has moved past them.
+typedef struct {
+    uint32_t busy_ms;       // read + hash time in the verify task (overlapped)
+    uint32_t wait_ms;       // time flash_verify_finish() blocked the caller
+    uint32_t bytes;         // bytes read back
+} flash_verify_stats_t;
+
+bool flash_verify_start(const esp_partition_t *part);
+
+// Call after each write with the running total written
+void flash_verify_written(size_t total_written);
+
+// Call once the writer is done (after esp_ota_end). Hash of the first
+// total bytes as read back from flash; false on read errors.
+bool flash_verify_finish(size_t total, uint8_t out32[32], flash_verify_stats_t *stats);
+
+// Stop early on failure paths; no-op if not started
+void flash_verify_abort(void);
+
+#endif
@@ -0,0 +1,82 @@
+#include "ota_buf_pool.h"
+#include "config/ota_config.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+// Chunks are whole flash sectors, and either divide a full TLS record
+// (16 KB) or are a multiple of it, so reads and writes stay aligned
+_Static_assert(OTA_CHUNK_SIZE % 4096 == 0, "OTA_CHUNK_SIZE must be a multiple of the flash sector");
+_Static_assert(16384 % OTA_CHUNK_SIZE == 0 || OTA_CHUNK_SIZE % 16384 == 0,
+               "OTA_CHUNK_SIZE must divide or be a multiple of the TLS record size");
+
+static const char *TAG = "OTA_POOL";
+
+static QueueHandle_t g_free = NULL;         // holds uint8_t* of free buffers
+static bool g_psram = false;
+
+static uint8_t *alloc_chunk(void)
+{
+    uint8_t *p = NULL;
+#if OTA_POOL_USE_PSRAM
+    if (heap_caps_get_total_size(MALLOC_CAP_SPIRAM) > 0)
+    {
+        p = heap_caps_malloc(OTA_CHUNK_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (p) g_psram = true;
+    }
+#endif
+    if (!p) p = heap_caps_malloc(OTA_CHUNK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    return p;
+}
+
+bool ota_buf_pool_init(void)
+{
+    if (g_free) return true;
+
+    g_free = xQueueCreate(OTA_POOL_BUFFERS, sizeof(uint8_t *));
+    if (!g_free) return false;
+
+    int n = 0;
+    for (; n < OTA_POOL_BUFFERS; n++)
+    {
+        uint8_t *p = alloc_chunk();
+        if (!p) break;
+        xQueueSend(g_free, &p, 0);
+    }
+
+    if (n == 0)
+    {
+        ESP_LOGE(TAG, "no memory for download buffers");
+        vQueueDelete(g_free);
+        g_free = NULL;
+        return false;
+    }
+
+    ESP_LOGI(TAG, "%d x %d bytes (%s)", n, OTA_CHUNK_SIZE, g_psram ? "PSRAM" : "internal");
+    return true;
+}
+
+uint8_t *ota_buf_get(uint32_t timeout_ms)
+{
+    uint8_t *p = NULL;
+    if (!g_free) return NULL;
+    if (xQueueReceive(g_free, &p, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) return NULL;
+    return p;
+}
+
+void ota_buf_put(uint8_t *buf)
+{
+    if (g_free && buf) xQueueSend(g_free, &buf, 0);
+}
+
+size_t ota_buf_size(void)
+{
+    return OTA_CHUNK_SIZE;
+}
+
+bool ota_buf_pool_in_psram(void)
+{
+    return g_psram;
+}
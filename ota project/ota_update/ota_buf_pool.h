@@ -0,0 +1,18 @@
+#ifndef OTA_BUF_POOL_H
+#define OTA_BUF_POOL_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Download buffers allocated once, before the heap gets fragmented.
+// Geometry comes from OTA_CHUNK_SIZE / OTA_POOL_BUFFERS in ota_config.h.
+bool ota_buf_pool_init(void);               // safe to call more than once
+
+uint8_t *ota_buf_get(uint32_t timeout_ms);  // NULL on timeout
+void ota_buf_put(uint8_t *buf);
+
+size_t ota_buf_size(void);
+bool ota_buf_pool_in_psram(void);
+
+#endif
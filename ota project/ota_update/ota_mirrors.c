@@ -0,0 +1,233 @@
+#include "ota_mirrors.h"
+#include "config/ota_config.h"
+#include "network/server_backoff.h"
+#include "network/tls_session.h"
+#include "storage/trace.h"
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "lwip/sockets.h"
+#include "lwip/netdb.h"
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <errno.h>
+
+static const char *TAG = "OTA_MIRROR";
+
+// Last probe, shared by the prefetch and the update task so both pick the
+// same URL and the warm connection gets adopted
+static struct {
+    char version[32];
+    uint8_t order[OTA_MIRRORS_MAX];
+    uint8_t count;
+    int64_t at_us;
+} g_rank;
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+
+static const char *url_at(const ota_manifest_t *m, uint8_t i)
+{
+    return i == 0 ? m->url : m->mirrors[i - 1];
+}
+
+/* ---------- Connect-latency probe ---------- */
+
+static bool url_host_port(const char *url, char *host, size_t host_sz, char *port, size_t port_sz)
+{
+    bool tls = strncmp(url, "https:", 6) == 0;
+    const char *p = strstr(url, "://");
+    p = p ? p + 3 : url;
+
+    size_t n = strcspn(p, ":/?");
+    if (n == 0 || n >= host_sz) return false;
+    memcpy(host, p, n);
+    host[n] = '\0';
+
+    if (p[n] == ':')
+    {
+        size_t k = strspn(p + n + 1, "0123456789");
+        if (k == 0 || k >= port_sz) return false;
+        memcpy(port, p + n + 1, k);
+        port[k] = '\0';
+    }
+    else
+    {
+        snprintf(port, port_sz, "%s", tls ? "443" : "80");
+    }
+    return true;
+}
+
+// Non-blocking connect to every host at once; UINT32_MAX = no answer
+// within OTA_MIRROR_PROBE_MS. DNS is outside the measurement.
+static void probe(const ota_manifest_t *m, uint8_t n, uint32_t *rtt_ms)
+{
+    int fd[OTA_MIRRORS_MAX];
+    int64_t t0[OTA_MIRRORS_MAX] = {0};
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        fd[i] = -1;
+        rtt_ms[i] = UINT32_MAX;
+
+        char host[128], port[8];
+        if (!url_host_port(url_at(m, i), host, sizeof(host), port, sizeof(port))) continue;
+
+        struct addrinfo *res = tls_session_resolve(host, port, OTA_MIRROR_PROBE_MS);
+        if (!res) continue;
+
+        int s = socket(res->ai_family, res->ai_socktype, 0);
+        if (s >= 0)
+        {
+            fcntl(s, F_SETFL, fcntl(s, F_GETFL, 0) | O_NONBLOCK);
+            t0[i] = esp_timer_get_time();
+            if (connect(s, res->ai_addr, res->ai_addrlen) == 0 || errno == EINPROGRESS) fd[i] = s;
+            else close(s);
+        }
+        freeaddrinfo(res);
+    }
+
+    int64_t deadline = esp_timer_get_time() + (int64_t)OTA_MIRROR_PROBE_MS * 1000;
+    for (;;)
+    {
+        fd_set wfds;
+        FD_ZERO(&wfds);
+        int maxfd = -1;
+        for (uint8_t i = 0; i < n; i++)
+        {
+            if (fd[i] < 0) continue;
+            FD_SET(fd[i], &wfds);
+            if (fd[i] > maxfd) maxfd = fd[i];
+        }
+
+        int64_t left = deadline - esp_timer_get_time();
+        if (maxfd < 0 || left <= 0) break;
+
+        struct timeval tv = { .tv_sec = left / 1000000, .tv_usec = left % 1000000 };
+        if (select(maxfd + 1, NULL, &wfds, NULL, &tv) <= 0) break;
+
+        int64_t now = esp_timer_get_time();
+        for (uint8_t i = 0; i < n; i++)
+        {
+            if (fd[i] < 0 || !FD_ISSET(fd[i], &wfds)) continue;
+
+            int e = 0;
+            socklen_t len = sizeof(e);
+            getsockopt(fd[i], SOL_SOCKET, SO_ERROR, &e, &len);
+            if (e == 0) rtt_ms[i] = (uint32_t)((now - t0[i]) / 1000);
+            close(fd[i]);
+            fd[i] = -1;
+        }
+    }
+
+    for (uint8_t i = 0; i < n; i++)
+    {
+        if (fd[i] >= 0) close(fd[i]);
+    }
+}
+
+/* ---------- Range responses ---------- */
+
+// "bytes <first>-<last>/<len>" starting at offset
+static bool range_starts_at(const char *v, size_t offset)
+{
+    if (strncasecmp(v, "bytes ", 6) != 0) return false;
+
+    char *end;
+    unsigned long first = strtoul(v + 6, &end, 10);
+    return end != v + 6 && *end == '-' && first == offset;
+}
+
+/* ---------- Public API ---------- */
+
+void ota_mirrors_init(ota_mirrors_t *mr, const ota_manifest_t *m)
+{
+    memset(mr, 0, sizeof(*mr));
+    mr->m = m;
+    mr->count = (uint8_t)(1 + (m->mirror_count < MANIFEST_MAX_MIRRORS ? m->mirror_count : MANIFEST_MAX_MIRRORS));
+    for (uint8_t i = 0; i < mr->count; i++) mr->order[i] = i;
+    if (mr->count == 1) return;
+
+    bool cached = false;
+    portENTER_CRITICAL(&g_mux);
+    if (g_rank.count == mr->count && strcmp(g_rank.version, m->version) == 0 &&
+        esp_timer_get_time() - g_rank.at_us < (int64_t)OTA_MIRROR_RANK_TTL_MS * 1000)
+    {
+        memcpy(mr->order, g_rank.order, mr->count);
+        cached = true;
+    }
+    portEXIT_CRITICAL(&g_mux);
+    if (cached) return;
+
+    uint32_t rtt[OTA_MIRRORS_MAX];
+    probe(m, mr->count, rtt);
+
+    // Stable: equal (or unreachable) hosts keep manifest order
+    for (uint8_t i = 1; i < mr->count; i++)
+    {
+        uint8_t v = mr->order[i];
+        int j = i - 1;
+        while (j >= 0 && rtt[mr->order[j]] > rtt[v])
+        {
+            mr->order[j + 1] = mr->order[j];
+            j--;
+        }
+        mr->order[j + 1] = v;
+    }
+
+    for (uint8_t i = 0; i < mr->count; i++)
+    {
+        uint8_t k = mr->order[i];
+        TRACE(TR_MIRROR_RTT, k, rtt[k]);
+        if (rtt[k] == UINT32_MAX) ESP_LOGW(TAG, "#%u %s: no connect", i, url_at(m, k));
+        else ESP_LOGI(TAG, "#%u %s: %lu ms", i, url_at(m, k), (unsigned long)rtt[k]);
+    }
+
+    portENTER_CRITICAL(&g_mux);
+    snprintf(g_rank.version, sizeof(g_rank.version), "%s", m->version);
+    memcpy(g_rank.order, mr->order, mr->count);
+    g_rank.count = mr->count;
+    g_rank.at_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&g_mux);
+}
+
+const char *ota_mirrors_url(const ota_mirrors_t *mr)
+{
+    return url_at(mr->m, mr->order[mr->pos]);
+}
+
+bool ota_mirrors_next(ota_mirrors_t *mr)
+{
+    if (mr->switches >= OTA_MIRROR_FAILOVERS) return false;
+    mr->switches++;
+    mr->pos = (uint8_t)((mr->pos + 1) % mr->count);
+    return true;
+}
+
+tls_conn_t *ota_mirrors_open(const char *url, size_t offset, int *status)
+{
+    *status = 0;
+    tls_reply_t reply;
+
+    // Returns with the headers read: the body must not be read as firmware on an error reply
+    int64_t t0 = esp_timer_get_time();
+    tls_conn_t *client = tls_session_get(url, offset, OTA_HTTP_TIMEOUT_MS, &reply);
+    if (!client) return NULL;
+
+    *status = reply.status;
+    server_backoff_note(*status, &reply.server);
+    TRACE(TR_HTTP_OPEN, *status, (esp_timer_get_time() - t0) / 1000);
+
+    // Appending bytes from anywhere else would corrupt the image
+    if (offset > 0 && *status == 206 && !range_starts_at(reply.content_range, offset))
+    {
+        ESP_LOGW(TAG, "%s: Content-Range \"%s\", asked for %u", url, reply.content_range, (unsigned)offset);
+        tls_session_release(client);
+        return NULL;
+    }
+
+    // Body flowing: a host that goes quiet this long is treated as dead
+    tls_session_set_timeout_ms(client, OTA_MIRROR_STALL_MS);
+    return client;
+}
@@ -0,0 +1,39 @@
+#ifndef OTA_MIRRORS_H
+#define OTA_MIRRORS_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "manifest/manifest_client.h"
+#include "network/tls_session.h"
+
+#define OTA_MIRRORS_MAX  (MANIFEST_MAX_MIRRORS + 1)
+
+// A manifest's firmware URLs ("url" + "mirrors") ranked by TCP connect
+// latency, and the position of the one in use
+typedef struct {
+    const ota_manifest_t *m;
+    uint8_t order[OTA_MIRRORS_MAX];   // 0 = url, n = mirrors[n - 1]
+    uint8_t count;
+    uint8_t pos;                      // index into order
+    uint8_t switches;                 // failovers used so far
+} ota_mirrors_t;
+
+// Ranks m's URLs: connects to all hosts in parallel, or reuses the probe
+// of the same release if it is younger than OTA_MIRROR_RANK_TTL_MS.
+// m must outlive mr.
+void ota_mirrors_init(ota_mirrors_t *mr, const ota_manifest_t *m);
+
+const char *ota_mirrors_url(const ota_mirrors_t *mr);
+
+// Next URL in rank order (wraps, so a single URL is simply retried);
+// false once OTA_MIRROR_FAILOVERS switches are used up
+bool ota_mirrors_next(ota_mirrors_t *mr);
+
+// GET url from offset (Range request when offset > 0) with the response
+// headers read and the read timeout lowered to OTA_MIRROR_STALL_MS.
+// NULL if there was no response, or a 206 whose Content-Range doesn't start
+// at offset; otherwise *status is the HTTP status and the caller owns the client.
+tls_conn_t *ota_mirrors_open(const char *url, size_t offset, int *status);
+
+#endif
@@ -0,0 +1,215 @@
+#include "ota_prefetch.h"
+#include "ota_update_manager.h"
+#include "ota_mirrors.h"
+#include "config/ota_config.h"
+#include "ota/ota_manager.h"
+#include "ota/ota_scheduler.h"
+#include "network/server_backoff.h"
+#include "network/tls_session.h"
+#include "network/wifi_manager.h"
+#include "storage/mem_monitor.h"
+
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include <string.h>
+#include <stdio.h>
+
+static const char *TAG = "OTA_PREFETCH";
+
+#define BIT_MF_DONE     (1u << 0)   // no manifest fetch in flight
+#define BIT_CONN_DONE   (1u << 1)   // no firmware connection being opened
+#define BIT_CONN_TAKEN  (1u << 2)   // update task adopted the warm connection
+
+static SemaphoreHandle_t g_lock = NULL;
+static EventGroupHandle_t g_ev = NULL;
+static TaskHandle_t g_task = NULL;
+
+// Last successful prefetch (g_lock)
+static ota_manifest_t g_cache;
+static bool g_cache_ok = false;
+static int64_t g_cache_us = 0;
+
+// Warm firmware connection (g_lock)
+static tls_conn_t *g_conn = NULL;
+static int g_conn_status = 0;
+static char g_conn_url[sizeof(((ota_manifest_t*)0)->url)];
+
+static ota_manifest_t g_tmp;            // prefetch task only
+
+static bool cache_fresh(void)
+{
+    return g_cache_ok && esp_timer_get_time() - g_cache_us < (int64_t)OTA_PREFETCH_MAX_AGE_MS * 1000;
+}
+
+/* ---------- Prefetch task ---------- */
+
+static void prefetch_task(void *arg)
+{
+    (void)arg;
+    mem_monitor_task_enter(OTA_PREFETCH_TASK_STACK);
+
+    char err[64];
+    int64_t t0 = esp_timer_get_time();
+    bool ok = manifest_fetch(&g_tmp, err, sizeof(err));
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    if (ok)
+    {
+        g_cache = g_tmp;
+        g_cache_ok = true;
+        g_cache_us = esp_timer_get_time();
+    }
+    xSemaphoreGive(g_lock);
+    xEventGroupSetBits(g_ev, BIT_MF_DONE);
+
+    if (ok) ESP_LOGI(TAG, "manifest %s ready %lu ms after IP", g_tmp.version, (unsigned long)((esp_timer_get_time() - t0) / 1000));
+    else ESP_LOGW(TAG, "prefetch failed: %s", err);
+
+    // Warm the firmware connection only when the update task will want it
+    bool warm = OTA_PREFETCH_WARM && ok &&
+                ota_update_version_is_newer(g_tmp.version) && manifest_in_rollout(&g_tmp);
+    tls_conn_t *c = NULL;
+    if (warm)
+    {
+        // Best mirror, ranked once for both this task and the update task
+        ota_mirrors_t mr;
+        ota_mirrors_init(&mr, &g_tmp);
+        const char *url = ota_mirrors_url(&mr);
+
+        int status = 0;
+        c = ota_mirrors_open(url, 0, &status);
+
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        g_conn = c;
+        g_conn_status = status;
+        snprintf(g_conn_url, sizeof(g_conn_url), "%s", url);
+        xSemaphoreGive(g_lock);
+    }
+    xEventGroupSetBits(g_ev, BIT_CONN_DONE);
+
+    if (c)
+    {
+        // An idle TLS session costs heap; give it back if nobody comes for it
+        xEventGroupWaitBits(g_ev, BIT_CONN_TAKEN, pdFALSE, pdTRUE, pdMS_TO_TICKS(OTA_PREFETCH_HOLD_MS));
+
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        c = g_conn;
+        g_conn = NULL;
+        xSemaphoreGive(g_lock);
+
+        if (c)
+        {
+            ESP_LOGI(TAG, "warm connection unused, closing");
+            tls_session_release(c);
+        }
+    }
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    g_task = NULL;
+    xSemaphoreGive(g_lock);
+
+    mem_monitor_task_exit();
+    vTaskDelete(NULL);
+}
+
+static void on_got_ip(void *arg, esp_event_base_t base, int32_t id, void *data)
+{
+    // Registered after wifi_manager's handler: only its STA sessions count,
+    // not the provisioning portal's credential test
+    if (!wifi_is_connected()) return;
+
+    // Only for a connect that a session or scheduled check is about to
+    // use: plain reconnects must not hit the server from the whole fleet
+    if (ota_get_state() != OTA_STATE_CONNECTING && !ota_scheduler_is_connecting()) return;
+    if (server_backoff_remaining_s() > 0) return;
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    bool start = (g_task == NULL) && !cache_fresh();
+    if (start)
+    {
+        xEventGroupClearBits(g_ev, BIT_MF_DONE | BIT_CONN_DONE | BIT_CONN_TAKEN);
+        if (xTaskCreate(prefetch_task, "ota_prefetch", OTA_PREFETCH_TASK_STACK, NULL, 4, &g_task) != pdPASS)
+        {
+            g_task = NULL;
+            xEventGroupSetBits(g_ev, BIT_MF_DONE | BIT_CONN_DONE);
+            ESP_LOGE(TAG, "task create failed");
+        }
+    }
+    xSemaphoreGive(g_lock);
+}
+
+/* ---------- Public API ---------- */
+
+void ota_prefetch_init(void)
+{
+    if (g_lock) return;
+
+    g_lock = xSemaphoreCreateMutex();
+    g_ev = xEventGroupCreate();
+    if (!g_lock || !g_ev)
+    {
+        ESP_LOGE(TAG, "init failed");
+        return;
+    }
+    xEventGroupSetBits(g_ev, BIT_MF_DONE | BIT_CONN_DONE);
+
+    if (OTA_PREFETCH_ENABLE)
+        esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, on_got_ip, NULL);
+}
+
+bool ota_prefetch_manifest(ota_manifest_t *m, char *err_msg, size_t err_sz)
+{
+    if (!m) return false;
+
+    if (g_ev)
+    {
+        xEventGroupWaitBits(g_ev, BIT_MF_DONE, pdFALSE, pdTRUE, pdMS_TO_TICKS(OTA_HTTP_TIMEOUT_MS));
+
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        bool fresh = cache_fresh();
+        if (fresh) *m = g_cache;
+        xSemaphoreGive(g_lock);
+
+        if (fresh)
+        {
+            if (err_msg && err_sz) err_msg[0] = '\0';
+            ESP_LOGI(TAG, "using prefetched manifest %s", m->version);
+            return true;
+        }
+    }
+
+    return manifest_fetch(m, err_msg, err_sz);
+}
+
+tls_conn_t *ota_prefetch_firmware(const char *url, int *status)
+{
+    if (g_ev)
+    {
+        xEventGroupWaitBits(g_ev, BIT_CONN_DONE, pdFALSE, pdTRUE, pdMS_TO_TICKS(OTA_HTTP_TIMEOUT_MS));
+
+        tls_conn_t *c = NULL;
+        xSemaphoreTake(g_lock, portMAX_DELAY);
+        if (g_conn && strcmp(g_conn_url, url) == 0)
+        {
+            c = g_conn;
+            *status = g_conn_status;
+            g_conn = NULL;
+        }
+        xSemaphoreGive(g_lock);
+
+        if (c)
+        {
+            xEventGroupSetBits(g_ev, BIT_CONN_TAKEN);
+            ESP_LOGI(TAG, "adopting warm firmware connection (HTTP %d)", *status);
+            return c;
+        }
+    }
+
+    return ota_mirrors_open(url, 0, status);
+}
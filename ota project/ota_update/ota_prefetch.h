@@ -0,0 +1,25 @@
+#ifndef OTA_PREFETCH_H
+#define OTA_PREFETCH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "manifest/manifest_client.h"
+#include "network/tls_session.h"
+
+// Speculative manifest fetch started on IP_EVENT_STA_GOT_IP, when that
+// connect was made for an update session or a scheduled check. When it shows
+// an update for this device, the connection to the best-ranked firmware
+// mirror is opened (TLS + headers) and held for the update task to adopt.
+
+// Registers the GOT_IP handler; call after wifi_manager_init()
+void ota_prefetch_init(void);
+
+// Joins a prefetch in flight, reuses one younger than OTA_PREFETCH_MAX_AGE_MS,
+// otherwise fetches now (same contract as manifest_fetch)
+bool ota_prefetch_manifest(ota_manifest_t *m, char *err_msg, size_t err_sz);
+
+// Firmware connection from the start of the image: the warmed one for url
+// if there is one, otherwise ota_mirrors_open(url, 0, status)
+tls_conn_t *ota_prefetch_firmware(const char *url, int *status);
+
+#endif
@@ -1,27 +1,35 @@
 #include "ota_update_manager.h"
 #include "config/ota_config.h"
 #include "manifest/manifest_client.h"
+#include "flash_verify.h"
+#include "ota_buf_pool.h"
+#include "ota_prefetch.h"
+#include "ota_mirrors.h"
 #include "security/sha256_util.h"
+#include "security/fw_decrypt.h"
 #include "storage/ota_diag.h"
+#include "storage/mem_monitor.h"
+#include "storage/trace.h"
+#include "network/server_backoff.h"
+#include "network/tls_session.h"
 
 #include "esp_log.h"
-#include "esp_http_client.h"
 #include "esp_app_desc.h"
 #include "esp_ota_ops.h"
 #include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <string.h>
 #include <stdio.h>
 
-#if OTA_USE_CRT_BUNDLE
-#include "esp_crt_bundle.h"
-#endif
-
 static const char *TAG = "OTA_UPD10";
 
 static ota_update_info_t g_info;
 static TaskHandle_t g_task = NULL;
+static ota_manifest_t g_mf;         // kept off the task stack
+static fw_decrypt_ctx_t g_dec;
 
 /* ---------- SemVer compare ---------- */
 static void parse_semver(const char *v, int *a, int *b, int *c)
@@ -43,6 +51,72 @@ static int semver_cmp(const char *v1, const char *v2)
     return 0;
 }
 
+static uint32_t ms_since(int64_t t0_us)
+{
+    return (uint32_t)((esp_timer_get_time() - t0_us) / 1000);
+}
+
+static void log_timing(const ota_update_timing_t *t, int bytes)
+{
+    ESP_LOGI(TAG, "timing: begin %lu ms, first write %lu ms, read %lu ms, decrypt %lu ms, write %lu ms, total %lu ms (%d bytes, %s erase)",
+             (unsigned long)t->begin_ms, (unsigned long)t->first_write_ms,
+             (unsigned long)t->read_ms, (unsigned long)t->decrypt_ms,
+             (unsigned long)t->write_ms, (unsigned long)t->total_ms,
+             bytes, OTA_SEQUENTIAL_ERASE ? "sequential" : "full");
+}
+
+static bool is_busy(int status)
+{
+    return status == 429 || status == 503;
+}
+
+// Firmware from offset: the current mirror, then the next ones in rank
+// order until one answers 200 (206 for a resume). Stops on 429/503 since
+// the backoff is already armed. NULL when nothing worked; *status is the
+// last reply.
+static tls_conn_t *open_firmware(ota_mirrors_t *mr, size_t offset, int *status)
+{
+    int want = offset ? 206 : 200;
+    tls_conn_t *c = offset ? ota_mirrors_open(ota_mirrors_url(mr), offset, status)
+                                        : ota_prefetch_firmware(ota_mirrors_url(mr), status);
+    while (!c || *status != want)
+    {
+        tls_session_release(c);
+        c = NULL;
+        if (is_busy(*status) || !ota_mirrors_next(mr)) return NULL;
+
+        g_info.failovers = mr->switches;
+        ESP_LOGW(TAG, "trying %s from %u", ota_mirrors_url(mr), (unsigned)offset);
+        TRACE(TR_FAILOVER, offset, mr->order[mr->pos]);
+        c = ota_mirrors_open(ota_mirrors_url(mr), offset, status);
+    }
+    return c;
+}
+
+static void record_mem(void)
+{
+    ota_update_mem_t *m = &g_info.mem;
+    m->stack_free_min = (uint32_t)uxTaskGetStackHighWaterMark(NULL);
+    m->heap_free_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    m->heap_free_end = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    m->pool_in_psram = ota_buf_pool_in_psram();
+
+    ESP_LOGI(TAG, "memory: stack free min %lu of %d, heap free min %lu, at exit %lu",
+             (unsigned long)m->stack_free_min, OTA_TASK_STACK,
+             (unsigned long)m->heap_free_min, (unsigned long)m->heap_free_end);
+}
+
+// Every exit path of ota_task except the reboot
+static void task_exit(void)
+{
+    TRACE(TR_OTA_RESULT, g_info.error, g_info.bytes_written);
+    record_mem();
+    tls_session_record_diag();
+    mem_monitor_task_exit();
+    g_task = NULL;
+    vTaskDelete(NULL);
+}
+
 static void set_fail(ota_update_error_t e, const char *msg)
 {
     g_info.status = OTA_UPD_FAILED;
@@ -55,79 +129,89 @@ static void set_fail(ota_update_error_t e, const char *msg)
 static void ota_task(void *arg)
 {
     (void)arg;
+    mem_monitor_task_enter(OTA_TASK_STACK);
 
     g_info.status = OTA_UPD_RUNNING;
+    g_info.phase = OTA_PHASE_MANIFEST;
     g_info.error = OTA_ERR_NONE;
     g_info.progress_percent = 0;
     g_info.bytes_written = 0;
     g_info.total_size = 0;
+    g_info.failovers = 0;
     g_info.remote_ver[0] = '\0';
     g_info.last_error[0] = '\0';
+    memset(&g_info.timing, 0, sizeof(g_info.timing));
 
     const esp_app_desc_t *app = esp_app_get_description();
     snprintf(g_info.current_ver, sizeof(g_info.current_ver), "%s", app->version);
 
-    // 1) Fetch manifest
-    ota_manifest_t mf;
+    // 1) Fetch manifest (or take the got-IP prefetch)
     char m_err[64];
-    if (!manifest_fetch(&mf, m_err, sizeof(m_err)))
+    if (!ota_prefetch_manifest(&g_mf, m_err, sizeof(m_err)))
     {
-        set_fail(OTA_ERR_MANIFEST_FETCH, m_err);
+        set_fail(server_backoff_remaining_s() > 0 ? OTA_ERR_SERVER_BUSY : OTA_ERR_MANIFEST_FETCH, m_err);
         ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, NULL, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        task_exit();
         return;
     }
 
-    snprintf(g_info.remote_ver, sizeof(g_info.remote_ver), "%s", mf.version);
-    g_info.total_size = (int)mf.size_bytes;
+    snprintf(g_info.remote_ver, sizeof(g_info.remote_ver), "%s", g_mf.version);
+    g_info.total_size = (int)g_mf.size_bytes;
 
     // Record attempted version early (useful even if it fails)
-    ota_diag_record_attempt(mf.version);
+    ota_diag_record_attempt(g_mf.version);
 
     // 2) Version check (prevent downgrade)
-    if (semver_cmp(mf.version, g_info.current_ver) <= 0)
+    if (semver_cmp(g_mf.version, g_info.current_ver) <= 0)
     {
         g_info.status = OTA_UPD_NO_UPDATE;
         g_info.error  = OTA_ERR_VERSION_NO_UPGRADE;
-        ota_diag_record_result(OTA_DIAG_STATUS_NO_UPDATE, (uint16_t)g_info.error, mf.version, app->version);
+        ota_diag_record_result(OTA_DIAG_STATUS_NO_UPDATE, (uint16_t)g_info.error, g_mf.version, app->version);
 
-        g_task = NULL;
-        vTaskDelete(NULL);
+        task_exit();
         return;
     }
 
-    // 3) Open HTTPS firmware URL
-    esp_http_client_config_t cfg = {
-        .url = mf.url,
-        .timeout_ms = OTA_HTTP_TIMEOUT_MS,
-#if OTA_USE_CRT_BUNDLE
-        .crt_bundle_attach = esp_crt_bundle_attach,
-#else
-        .cert_pem = ROOT_CA_PEM,
-#endif
-        .buffer_size = 4096,
-        .buffer_size_tx = 1024
-    };
+    // 2b) Rollout wave: devices outside it don't touch the firmware URL
+    if (!manifest_in_rollout(&g_mf))
+    {
+        ESP_LOGI(TAG, "%s not rolled out to this device yet (bucket %u, wave %u%%)",
+                 g_mf.version, manifest_rollout_bucket(&g_mf), g_mf.rollout_pct);
+        g_info.status = OTA_UPD_NO_UPDATE;
+        g_info.error  = OTA_ERR_NOT_IN_ROLLOUT;
+        ota_diag_record_result(OTA_DIAG_STATUS_NO_UPDATE, (uint16_t)g_info.error, g_mf.version, app->version);
+        task_exit();
+        return;
+    }
 
-    esp_http_client_handle_t client = esp_http_client_init(&cfg);
-    if (!client)
+    // Encrypted image: load the key before connecting, so a device without
+    // one fails without downloading anything
+    if (!fw_decrypt_init(&g_dec, g_mf.cipher, g_mf.key_id, g_mf.iv))
     {
-        set_fail(OTA_ERR_HTTP_OPEN, "http init failed");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        set_fail(OTA_ERR_DECRYPT, "decrypt setup failed");
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
-    esp_err_t err = esp_http_client_open(client, 0);
-    if (err != ESP_OK)
+    // 3) Firmware connection: fastest mirror, usually already open (TLS +
+    // headers) from the got-IP prefetch; the others if it doesn't answer
+    ota_mirrors_t mirrors;
+    ota_mirrors_init(&mirrors, &g_mf);
+
+    int64_t t_open = esp_timer_get_time();
+    int status = 0;
+    tls_conn_t *client = open_firmware(&mirrors, 0, &status);
+    if (!client)
     {
-        esp_http_client_cleanup(client);
-        set_fail(OTA_ERR_HTTP_OPEN, "http open failed");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        fw_decrypt_free(&g_dec);
+        bool busy = is_busy(status);
+        char msg[40];
+        if (status > 0) snprintf(msg, sizeof(msg), "%s (HTTP %d)", busy ? "server busy" : "http status", status);
+        else snprintf(msg, sizeof(msg), "http open failed");
+        set_fail(busy ? OTA_ERR_SERVER_BUSY : OTA_ERR_HTTP_OPEN, msg);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
@@ -135,39 +219,93 @@ static void ota_task(void *arg)
     const esp_partition_t *update_part = esp_ota_get_next_update_partition(NULL);
     if (!update_part)
     {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
+        tls_session_release(client);
+        fw_decrypt_free(&g_dec);
         set_fail(OTA_ERR_OTA_BEGIN, "no update partition");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
+    // Sequential mode erases each sector as the write pointer reaches it,
+    // so the connection never sits idle through a multi-second erase
     esp_ota_handle_t ota_handle = 0;
-    err = esp_ota_begin(update_part, mf.size_bytes, &ota_handle);
+    esp_err_t err;
+    int64_t t_begin = esp_timer_get_time();
+#if OTA_SEQUENTIAL_ERASE
+    err = esp_ota_begin(update_part, OTA_WITH_SEQUENTIAL_WRITES, &ota_handle);
+#else
+    err = esp_ota_begin(update_part, g_mf.size_bytes, &ota_handle);
+#endif
+    g_info.timing.begin_ms = ms_since(t_begin);
+    TRACE(TR_OTA_BEGIN, g_info.timing.begin_ms, OTA_SEQUENTIAL_ERASE);
     if (err != ESP_OK)
     {
-        esp_http_client_close(client);
-        esp_http_client_cleanup(client);
+        tls_session_release(client);
+        fw_decrypt_free(&g_dec);
         set_fail(OTA_ERR_OTA_BEGIN, "esp_ota_begin failed");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
+        return;
+    }
+
+#if OTA_FLASH_VERIFY
+    // Without the read-back task the image could never pass 8b; fail now,
+    // before downloading anything
+    if (!flash_verify_start(update_part))
+    {
+        esp_ota_abort(ota_handle);
+        tls_session_release(client);
+        fw_decrypt_free(&g_dec);
+        set_fail(OTA_ERR_FLASH_VERIFY, "flash verify unavailable");
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
+#endif
 
-    // 5) Streaming loop (4KB chunks) + SHA256
-    uint8_t buf[4096];
+    // 5) Streaming loop (pool chunks) + SHA256
+    g_info.phase = OTA_PHASE_DOWNLOAD;
     sha256_ctx_t sha;
     sha256_init(&sha);
 
     int total_written = 0;
     bool ok = true;
 
-    while (1)
+    size_t chunk = ota_buf_size();
+    uint8_t *buf = ota_buf_get(1000);
+    if (!buf)
     {
-        int r = esp_http_client_read(client, (char*)buf, sizeof(buf));
+        ok = false;
+        set_fail(OTA_ERR_NO_MEM, "no download buffer");
+    }
+
+    ota_update_timing_t *tm = &g_info.timing;
+    int64_t read_us = 0, dec_us = 0, write_us = 0;
+
+    while (ok)
+    {
+        // Fill the whole chunk so every write covers complete sectors
+        int64_t t0 = esp_timer_get_time();
+        int r = 0;
+        while ((size_t)r < chunk)
+        {
+            int n = tls_session_read(client, buf + r, chunk - r);
+            if (n > 0) { r += n; continue; }
+
+            size_t got = (size_t)total_written + (size_t)r;
+            if (n == 0 && got >= g_mf.size_bytes) break; // EOF
+
+            // Error, stall or short body: carry on from here on the next
+            // mirror; bytes already in buf stay, so hash and CTR state hold
+            tls_session_release(client);
+            ESP_LOGW(TAG, "read failed at %u (%d), failing over", (unsigned)got, n);
+            client = open_firmware(&mirrors, got, &status);
+            if (!client) { r = -1; break; }
+        }
+        int64_t t1 = esp_timer_get_time();
+        read_us += t1 - t0;
+        TRACE(TR_HTTP_READ, r, t1 - t0);
         if (r < 0)
         {
             ok = false;
@@ -176,9 +314,26 @@ static void ota_task(void *arg)
         }
         if (r == 0) break; // EOF
 
+        // Same chunk, in place: the hash and flash both see plaintext
+        if (!fw_decrypt_update(&g_dec, buf, (size_t)r))
+        {
+            ok = false;
+            set_fail(OTA_ERR_DECRYPT, "decrypt failed");
+            break;
+        }
+        int64_t t1d = esp_timer_get_time();
+        dec_us += t1d - t1;
+        if (fw_decrypt_enabled(&g_dec)) TRACE(TR_DECRYPT, r, t1d - t1);
+
         sha256_update(&sha, buf, (size_t)r);
+        int64_t t1s = esp_timer_get_time();
+        TRACE(TR_SHA, r, t1s - t1d);
 
         err = esp_ota_write(ota_handle, buf, r);
+        int64_t t2 = esp_timer_get_time();
+        write_us += t2 - t1s;
+        TRACE(TR_OTA_WRITE, total_written, t2 - t1s);
+        if (total_written == 0) tm->first_write_ms = (uint32_t)((t2 - t_open) / 1000);
         if (err != ESP_OK)
         {
             ok = false;
@@ -187,17 +342,18 @@ static void ota_task(void *arg)
         }
 
         total_written += r;
+        flash_verify_written((size_t)total_written);
 
         g_info.bytes_written = total_written;
-        if (mf.size_bytes > 0)
+        if (g_mf.size_bytes > 0)
         {
-            int pct = (int)((total_written * 100LL) / (long long)mf.size_bytes);
+            int pct = (int)((total_written * 100LL) / (long long)g_mf.size_bytes);
             if (pct > 100) pct = 100;
             if (pct < 0) pct = 0;
             g_info.progress_percent = pct;
         }
 
-        if (mf.size_bytes > 0 && (size_t)total_written > mf.size_bytes)
+        if (g_mf.size_bytes > 0 && (size_t)total_written > g_mf.size_bytes)
         {
             ok = false;
             set_fail(OTA_ERR_SIZE_MISMATCH, "download bigger than manifest size");
@@ -205,28 +361,38 @@ static void ota_task(void *arg)
         }
     }
 
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+    ota_buf_put(buf);
+    fw_decrypt_free(&g_dec);
+
+    tm->read_ms = (uint32_t)(read_us / 1000);
+    tm->decrypt_ms = (uint32_t)(dec_us / 1000);
+    tm->write_ms = (uint32_t)(write_us / 1000);
+    tm->total_ms = ms_since(t_open);
+    TRACE(TR_HTTP_DONE, total_written, g_info.error);
+    log_timing(tm, total_written);
+
+    tls_session_release(client);
 
     if (!ok)
     {
+        flash_verify_abort();
         sha256_free(&sha);
         esp_ota_abort(ota_handle);
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
     // 6) Size validation
-    if ((size_t)total_written != mf.size_bytes)
+    g_info.phase = OTA_PHASE_VERIFY;
+    if ((size_t)total_written != g_mf.size_bytes)
     {
+        flash_verify_abort();
         sha256_free(&sha);
         esp_ota_abort(ota_handle);
         set_fail(OTA_ERR_SIZE_MISMATCH, "size mismatch vs manifest");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
@@ -237,13 +403,13 @@ static void ota_task(void *arg)
     sha256_free(&sha);
     sha256_to_hex(hash32, hash_hex);
 
-    if (!sha256_hex_equal(hash_hex, mf.sha256))
+    if (!sha256_hex_equal(hash_hex, g_mf.sha256))
     {
+        flash_verify_abort();
         esp_ota_abort(ota_handle);
         set_fail(OTA_ERR_SHA256_MISMATCH, "sha256 mismatch");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
@@ -251,21 +417,40 @@ static void ota_task(void *arg)
     err = esp_ota_end(ota_handle);
     if (err != ESP_OK)
     {
+        flash_verify_abort();
         set_fail(OTA_ERR_OTA_END, "esp_ota_end failed");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
+        return;
+    }
+
+#if OTA_FLASH_VERIFY
+    // 8b) Read-back: what is on flash must hash to what was streamed. Most
+    // sectors were already hashed during the download; only the tail is left.
+    uint8_t flash_hash[32];
+    flash_verify_stats_t vs = {0};
+    if (!flash_verify_finish((size_t)total_written, flash_hash, &vs) ||
+        memcmp(flash_hash, hash32, sizeof(hash32)) != 0)
+    {
+        set_fail(OTA_ERR_FLASH_VERIFY, "flash read-back mismatch");
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
+    g_info.timing.verify_ms = vs.busy_ms;
+    g_info.timing.verify_wait_ms = vs.wait_ms;
+    ESP_LOGI(TAG, "flash verify ok: %lu bytes, %lu ms overlapped, %lu ms added",
+             (unsigned long)vs.bytes, (unsigned long)vs.busy_ms, (unsigned long)vs.wait_ms);
+#endif
 
     // 9) Set boot partition
+    g_info.phase = OTA_PHASE_INSTALL;
     err = esp_ota_set_boot_partition(update_part);
     if (err != ESP_OK)
     {
         set_fail(OTA_ERR_SET_BOOT, "set boot partition failed");
-        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, mf.version, NULL);
-        g_task = NULL;
-        vTaskDelete(NULL);
+        ota_diag_record_result(OTA_DIAG_STATUS_FAILED, (uint16_t)g_info.error, g_mf.version, NULL);
+        task_exit();
         return;
     }
 
@@ -274,10 +459,13 @@ static void ota_task(void *arg)
     g_info.status = OTA_UPD_SUCCESS;
     g_info.error = OTA_ERR_NONE;
 
-    ota_diag_record_result(OTA_DIAG_STATUS_SUCCESS, 0, mf.version, NULL);
+    ota_diag_record_result(OTA_DIAG_STATUS_SUCCESS, 0, g_mf.version, NULL);
 
+    record_mem();
+    tls_session_record_diag();
     ESP_LOGI(TAG, "OTA SUCCESS -> rebooting");
     vTaskDelay(pdMS_TO_TICKS(800));
+    TRACE(TR_RESTART, 0, total_written);
     esp_restart();
 }
 
@@ -287,6 +475,18 @@ void ota_update_init(void)
     memset(&g_info, 0, sizeof(g_info));
     g_info.status = OTA_UPD_IDLE;
     g_info.error = OTA_ERR_NONE;
+
+    // Allocate download buffers now, while the heap is still unfragmented
+    if (!ota_buf_pool_init()) ESP_LOGE(TAG, "download buffer pool unavailable");
+
+#if OTA_DECRYPT_BENCH
+    uint8_t *b = ota_buf_get(0);
+    if (b)
+    {
+        fw_decrypt_benchmark(b, ota_buf_size());
+        ota_buf_put(b);
+    }
+#endif
 }
 
 void ota_update_start(void)
@@ -297,7 +497,22 @@ void ota_update_start(void)
         return;
     }
 
-    xTaskCreate(ota_task, "ota_stream_task", 8192, NULL, 5, &g_task);
+    // Visible before the task first runs, so pollers never see a stale result
+    g_info.status = OTA_UPD_RUNNING;
+    g_info.phase = OTA_PHASE_MANIFEST;
+
+    if (xTaskCreate(ota_task, "ota_stream_task", OTA_TASK_STACK, NULL, 5, &g_task) != pdPASS)
+    {
+        // Otherwise the state machine waits on RUNNING forever
+        g_task = NULL;
+        set_fail(OTA_ERR_NO_MEM, "task create failed");
+        ESP_LOGE(TAG, "OTA task create failed");
+    }
+}
+
+bool ota_update_version_is_newer(const char *remote_ver)
+{
+    return semver_cmp(remote_ver, esp_app_get_description()->version) > 0;
 }
 
 ota_update_info_t ota_update_get_info(void)
@@ -24,25 +24,67 @@ typedef enum {
     OTA_ERR_OTA_WRITE = 9,
     OTA_ERR_OTA_END = 10,
     OTA_ERR_SET_BOOT = 11,
-    OTA_ERR_ROLLBACK = 12
+    OTA_ERR_ROLLBACK = 12,
+    OTA_ERR_FLASH_VERIFY = 13,
+    OTA_ERR_DECRYPT = 14,
+    OTA_ERR_SERVER_BUSY = 15,       // 429/503 or Retry-After wait still running
+    OTA_ERR_NOT_IN_ROLLOUT = 16,    // newer version, but not this device's wave yet
+    OTA_ERR_NO_MEM = 17             // download buffer unavailable
 } ota_update_error_t;
 
+// Where a running update is; the state machine maps these to its states
+typedef enum {
+    OTA_PHASE_NONE = 0,
+    OTA_PHASE_MANIFEST,       // fetching + checking the manifest
+    OTA_PHASE_DOWNLOAD,       // streaming to flash
+    OTA_PHASE_VERIFY,         // size, SHA-256, image validation
+    OTA_PHASE_INSTALL         // switching the boot partition
+} ota_update_phase_t;
+
+// Download timing, ms. erase/write time is spent inside esp_ota_begin/write.
+typedef struct {
+    uint32_t begin_ms;        // esp_ota_begin (full erase when not sequential)
+    uint32_t first_write_ms;  // HTTP open -> first chunk in flash
+    uint32_t read_ms;         // total in tls_session_read
+    uint32_t write_ms;        // total in esp_ota_write (includes erase)
+    uint32_t decrypt_ms;      // total in AES-CTR (0 for plain images)
+    uint32_t total_ms;        // HTTP open -> last chunk written
+    uint32_t verify_ms;       // flash read-back, overlapped with the download
+    uint32_t verify_wait_ms;  // read-back time left after the download
+} ota_update_timing_t;
+
+// Memory seen by the last run, bytes
+typedef struct {
+    uint32_t stack_free_min;  // ota_stream_task high-water mark
+    uint32_t heap_free_min;   // internal heap low-water mark since boot
+    uint32_t heap_free_end;   // internal heap free when the task exited
+    bool pool_in_psram;
+} ota_update_mem_t;
+
 typedef struct {
     ota_update_status_t status;
+    ota_update_phase_t  phase;
     ota_update_error_t  error;
 
     int progress_percent;     // 0..100
     int bytes_written;        // best-effort (int)
     int total_size;           // from manifest (int)
+    int failovers;            // mirror switches / resumes in this download
 
     char current_ver[32];
     char remote_ver[32];
     char last_error[64];
+
+    ota_update_timing_t timing;
+    ota_update_mem_t mem;
 } ota_update_info_t;
 
 void ota_update_init(void);
 void ota_update_start(void);
 
+// remote_ver is above the running app version (SemVer, leading 'v' allowed)
+bool ota_update_version_is_newer(const char *remote_ver);
+
 ota_update_info_t ota_update_get_info(void);
 bool ota_update_is_running(void);
 
@@ -0,0 +1,164 @@
+#include "dns_responder.h"
+#include "config/provisioning_config.h"
+
+#include <string.h>
+
+#define DNS_HDR_LEN     12
+
+#define DNS_TYPE_A      1
+#define DNS_TYPE_SOA    6
+#define DNS_TYPE_ANY    255
+#define DNS_CLASS_IN    1
+
+#define DNS_FLAG_QR     0x8000
+#define DNS_FLAG_AA     0x0400
+#define DNS_FLAG_RD     0x0100
+#define DNS_FLAG_RA     0x0080
+#define DNS_RCODE_NOTIMP 4
+
+// Precomputed records, appended after the echoed question.
+// Both start with a compression pointer to the QNAME at offset 12.
+static uint8_t s_answer_a[16];
+static uint8_t s_authority_soa[34];
+
+typedef struct {
+    uint32_t ip;
+    int64_t last_ms;
+    int32_t milli_tokens;
+} rate_slot_t;
+
+static rate_slot_t s_rate[PROV_DNS_RATE_CLIENTS];
+
+static uint16_t rd16(const uint8_t *p) { return (uint16_t)((p[0] << 8) | p[1]); }
+
+static void wr16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)(v >> 8);
+    p[1] = (uint8_t)v;
+}
+
+static void wr32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)(v >> 24);
+    p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);
+    p[3] = (uint8_t)v;
+}
+
+void dns_responder_init(uint32_t ip_be, uint32_t ttl_s)
+{
+    uint8_t *a = s_answer_a;
+    a[0] = 0xC0; a[1] = 0x0C;
+    wr16(&a[2], DNS_TYPE_A);
+    wr16(&a[4], DNS_CLASS_IN);
+    wr32(&a[6], ttl_s);
+    wr16(&a[10], 4);
+    memcpy(&a[12], &ip_be, 4);
+
+    // SOA: root MNAME/RNAME, MINIMUM = ttl (negative-caching TTL)
+    uint8_t *s = s_authority_soa;
+    s[0] = 0xC0; s[1] = 0x0C;
+    wr16(&s[2], DNS_TYPE_SOA);
+    wr16(&s[4], DNS_CLASS_IN);
+    wr32(&s[6], ttl_s);
+    wr16(&s[10], 22);
+    s[12] = 0;                  // MNAME
+    s[13] = 0;                  // RNAME
+    wr32(&s[14], 1);            // SERIAL
+    wr32(&s[18], ttl_s);        // REFRESH
+    wr32(&s[22], ttl_s);        // RETRY
+    wr32(&s[26], ttl_s);        // EXPIRE
+    wr32(&s[30], ttl_s);        // MINIMUM
+
+    memset(s_rate, 0, sizeof(s_rate));
+}
+
+int dns_responder_answer(uint8_t *buf, int len, int cap)
+{
+    if (!buf || len < DNS_HDR_LEN || cap < len) return 0;
+
+    uint16_t qflags = rd16(&buf[2]);
+    if (qflags & DNS_FLAG_QR) return 0;             // a response, not a query
+    if (rd16(&buf[4]) == 0) return 0;               // no question
+
+    // First question only: QNAME labels, then QTYPE + QCLASS
+    int off = DNS_HDR_LEN;
+    while (off < len && buf[off] != 0)
+    {
+        if (buf[off] & 0xC0) return 0;              // no compression expected in a question
+        off += buf[off] + 1;
+    }
+    off++;
+    if (off + 4 > len) return 0;
+
+    uint16_t qtype = rd16(&buf[off]);
+    uint16_t qclass = rd16(&buf[off + 2]);
+    int qend = off + 4;
+
+    uint16_t opcode = (uint16_t)((qflags >> 11) & 0xF);
+    uint16_t rflags = DNS_FLAG_QR | DNS_FLAG_AA | DNS_FLAG_RA |
+                      (uint16_t)(opcode << 11) | (qflags & DNS_FLAG_RD);
+
+    // Header: keep ID, rewrite flags and counts; drop anything after the question
+    wr16(&buf[4], 1);
+    wr16(&buf[6], 0);
+    wr16(&buf[8], 0);
+    wr16(&buf[10], 0);
+
+    if (opcode != 0)
+    {
+        wr16(&buf[2], rflags | DNS_RCODE_NOTIMP);
+        return qend;
+    }
+
+    wr16(&buf[2], rflags);
+
+    if (qclass == DNS_CLASS_IN && (qtype == DNS_TYPE_A || qtype == DNS_TYPE_ANY))
+    {
+        if (qend + (int)sizeof(s_answer_a) > cap) return 0;
+        memcpy(&buf[qend], s_answer_a, sizeof(s_answer_a));
+        wr16(&buf[6], 1);
+        return qend + (int)sizeof(s_answer_a);
+    }
+
+    // NODATA: the name exists (everything does) but has no record of this type
+    if (qend + (int)sizeof(s_authority_soa) > cap) return 0;
+    memcpy(&buf[qend], s_authority_soa, sizeof(s_authority_soa));
+    wr16(&buf[8], 1);
+    return qend + (int)sizeof(s_authority_soa);
+}
+
+bool dns_rate_allow(uint32_t client_ip, int64_t now_ms)
+{
+    const int32_t cap = PROV_DNS_RATE_BURST * 1000;
+
+    rate_slot_t *slot = NULL;
+    rate_slot_t *oldest = &s_rate[0];
+    for (int i = 0; i < PROV_DNS_RATE_CLIENTS; i++)
+    {
+        if (s_rate[i].ip == client_ip && s_rate[i].last_ms != 0) { slot = &s_rate[i]; break; }
+        if (s_rate[i].last_ms < oldest->last_ms) oldest = &s_rate[i];
+    }
+
+    if (!slot)
+    {
+        // New client (or evicted): start with a full bucket
+        slot = oldest;
+        slot->ip = client_ip;
+        slot->milli_tokens = cap;
+    }
+    else
+    {
+        int64_t elapsed = now_ms - slot->last_ms;
+        if (elapsed > 0)
+        {
+            int64_t t = (int64_t)slot->milli_tokens + elapsed * PROV_DNS_RATE_QPS;
+            slot->milli_tokens = (t > cap) ? cap : (int32_t)t;
+        }
+    }
+    slot->last_ms = now_ms ? now_ms : 1;
+
+    if (slot->milli_tokens < 1000) return false;
+    slot->milli_tokens -= 1000;
+    return true;
+}
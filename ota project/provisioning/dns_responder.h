@@ -0,0 +1,25 @@
+#ifndef DNS_RESPONDER_H
+#define DNS_RESPONDER_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Wildcard captive-portal DNS logic, kept free of ESP-IDF/lwIP so the
+// host benchmark (tools/dns_bench.c) can drive it directly.
+
+#define DNS_MAX_PACKET  512
+
+// ip_be: answer address in network byte order
+void dns_responder_init(uint32_t ip_be, uint32_t ttl_s);
+
+// Rewrites the query in buf (len bytes, cap bytes available) into the
+// response, in place. Returns the response length, or 0 to drop.
+//   A / ANY (IN)      -> wildcard A record
+//   AAAA, HTTPS, ...  -> NOERROR/NODATA with SOA, so clients cache the miss
+//   opcode != QUERY   -> NOTIMP
+int dns_responder_answer(uint8_t *buf, int len, int cap);
+
+// Per-client token bucket (client_ip as received, any byte order)
+bool dns_rate_allow(uint32_t client_ip, int64_t now_ms);
+
+#endif
@@ -0,0 +1,13 @@
+var f=document.getElementById('t'),r=document.getElementById('r');
+function poll(id){fetch('/status').then(function(x){return x.json()}).then(function(s){
+if(!s.test||s.test.job!=id)return;r.textContent='Test: '+s.test.state;
+if(s.test.state=='running')setTimeout(function(){poll(id)},700)})}
+f.onsubmit=function(e){e.preventDefault();r.textContent='Testing...';
+fetch('/test',{method:'POST',body:new URLSearchParams(new FormData(f))})
+.then(function(x){return x.json()}).then(function(j){poll(j.job)})
+.catch(function(){r.textContent='Test: error'})};
+function aps(){fetch('/scan').then(function(x){return x.json()}).then(function(s){
+var d=document.getElementById('aps');d.innerHTML='';s.aps.forEach(function(a){
+var o=document.createElement('option');o.value=a.ssid;o.label=a.rssi+' dBm';d.appendChild(o)});
+if(s.scanning||!s.aps.length)setTimeout(aps,2000)})}
+aps();
@@ -0,0 +1,122 @@
+// Generated by tools/gen_portal_assets.py - do not edit.
+// Sources: provisioning/portal/
+
+#include "portal_assets.h"
+
+// index.html: 910 -> 410 bytes
+static const uint8_t asset_index_html[410] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0xdd, 0x53, 0x4d, 0x8f, 0xd4, 0x30,
+    0x0c, 0xbd, 0xcf, 0xaf, 0x08, 0xa7, 0x5c, 0x58, 0x2a, 0x66, 0x10, 0xa7, 0x34, 0x17, 0x3e, 0x24,
+    0x2e, 0x30, 0x52, 0x57, 0xe2, 0x9c, 0x26, 0xde, 0xad, 0xd9, 0x34, 0x09, 0xb1, 0x3b, 0xc3, 0xfc,
+    0x7b, 0x9c, 0x76, 0x46, 0x80, 0x60, 0xff, 0x00, 0x87, 0xb6, 0x49, 0xfc, 0xfc, 0x1c, 0x3f, 0xbf,
+    0x9a, 0x17, 0x21, 0x7b, 0xbe, 0x14, 0x50, 0x13, 0xcf, 0xd1, 0x9a, 0xeb, 0x1b, 0x5c, 0xb0, 0x66,
+    0x06, 0x76, 0x2a, 0xb9, 0x19, 0x7a, 0x7d, 0x42, 0x38, 0x97, 0x5c, 0x59, 0x2b, 0x9f, 0x13, 0x43,
+    0xe2, 0x5e, 0x9f, 0x31, 0xf0, 0xd4, 0x07, 0x38, 0xa1, 0x87, 0xbb, 0x75, 0xf3, 0x12, 0x13, 0x32,
+    0xba, 0x78, 0x47, 0xde, 0x45, 0xe8, 0x5f, 0x6b, 0xbb, 0x33, 0x8c, 0x1c, 0xc1, 0x7e, 0x18, 0x8e,
+    0x87, 0xbd, 0xfa, 0x8a, 0x1f, 0x51, 0x0d, 0xc0, 0x4b, 0x31, 0xdd, 0x76, 0x6e, 0x22, 0xa6, 0x27,
+    0x55, 0x21, 0xf6, 0x9a, 0xf8, 0x12, 0x81, 0x26, 0x00, 0xa9, 0x31, 0x55, 0x78, 0xe8, 0x75, 0xd7,
+    0x0a, 0xba, 0xf8, 0xca, 0x13, 0x69, 0x6b, 0xba, 0xed, 0x4e, 0x63, 0x0e, 0x17, 0xa1, 0x9d, 0xf6,
+    0xbf, 0x73, 0x1e, 0x6b, 0x3e, 0x21, 0x61, 0x4e, 0x98, 0x1e, 0x05, 0xb8, 0x17, 0x40, 0x70, 0x92,
+    0x8a, 0xc4, 0x0a, 0x43, 0xaf, 0x5d, 0x59, 0x19, 0x6e, 0x67, 0x12, 0x7e, 0xc8, 0x75, 0x56, 0xd2,
+    0xdf, 0x94, 0x25, 0x7c, 0xfc, 0x32, 0xdc, 0x6b, 0xe5, 0x3c, 0x0b, 0x83, 0x94, 0x25, 0x77, 0x82,
+    0x76, 0xf5, 0xe8, 0x46, 0x88, 0x76, 0x18, 0x3e, 0xbd, 0x37, 0xdd, 0xb6, 0x36, 0x63, 0xb5, 0x06,
+    0x53, 0x59, 0xf8, 0x2a, 0x0b, 0x11, 0x06, 0xad, 0x1a, 0xe7, 0x56, 0x44, 0xcd, 0xee, 0x47, 0x84,
+    0xf4, 0x28, 0xc2, 0xe8, 0xc3, 0x5e, 0x4b, 0x67, 0xdf, 0x17, 0xac, 0x10, 0xb6, 0x4c, 0x79, 0x6e,
+    0xac, 0x47, 0x47, 0x74, 0xce, 0x35, 0x3c, 0xcb, 0x5c, 0x04, 0xa0, 0x55, 0x1b, 0xcc, 0xb6, 0x6e,
+    0xe0, 0x3f, 0xe8, 0xdf, 0xbe, 0xf9, 0x27, 0xfd, 0xb8, 0x30, 0xe7, 0x74, 0x4d, 0xa4, 0x65, 0x9c,
+    0x91, 0xb5, 0x1d, 0xa4, 0x23, 0xd3, 0x6d, 0x21, 0xc1, 0x74, 0xad, 0x7b, 0x19, 0x72, 0xc3, 0x4f,
+    0x07, 0xfb, 0x19, 0x58, 0xd8, 0x9f, 0xd4, 0x3d, 0x10, 0x8b, 0x7a, 0x87, 0x9b, 0x3c, 0x4d, 0x39,
+    0x19, 0xc6, 0x33, 0x2a, 0xb1, 0xa0, 0xff, 0x2f, 0x95, 0x5a, 0xff, 0xea, 0x5d, 0x4e, 0x09, 0x3c,
+    0xff, 0xa5, 0xd6, 0xce, 0x94, 0x55, 0x90, 0xda, 0x8c, 0x54, 0xda, 0xd6, 0x1a, 0x77, 0x33, 0x2a,
+    0xb1, 0xe3, 0x45, 0x2c, 0x36, 0xac, 0x5f, 0xd3, 0xb9, 0x2b, 0x86, 0x7c, 0xc5, 0xc2, 0x8a, 0xaa,
+    0xff, 0xe5, 0xe6, 0x6f, 0xab, 0x15, 0xb7, 0x48, 0x63, 0x5f, 0x0d, 0x2d, 0xb2, 0xb7, 0xff, 0x6e,
+    0xf7, 0x13, 0x39, 0x5c, 0xb9, 0xad, 0x8e, 0x03, 0x00, 0x00,
+};
+
+// saved.html: 697 -> 451 bytes
+static const uint8_t asset_saved_html[451] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x5d, 0x52, 0xc1, 0x6e, 0xdb, 0x30,
+    0x0c, 0xbd, 0xfb, 0x2b, 0xd8, 0x5e, 0x64, 0xa3, 0xa9, 0x9c, 0xa5, 0xc0, 0x7a, 0x88, 0xec, 0xc3,
+    0x82, 0x0e, 0x1b, 0xb0, 0x01, 0x03, 0x12, 0x60, 0x67, 0x4d, 0x62, 0x62, 0xb5, 0x8a, 0x64, 0x48,
+    0x74, 0x12, 0x23, 0xc8, 0xbf, 0x4f, 0x8e, 0xe3, 0x61, 0xed, 0x45, 0x90, 0x28, 0xf2, 0xf1, 0xbd,
+    0x47, 0x8a, 0x3b, 0xed, 0x15, 0xf5, 0x2d, 0x42, 0x43, 0x7b, 0x5b, 0x8b, 0xdb, 0x89, 0x52, 0xd7,
+    0x62, 0x8f, 0x24, 0xc1, 0xc9, 0x3d, 0x56, 0xec, 0x60, 0xf0, 0xd8, 0xfa, 0x40, 0x0c, 0x94, 0x77,
+    0x84, 0x8e, 0x2a, 0x76, 0x34, 0x9a, 0x9a, 0x4a, 0xe3, 0xc1, 0x28, 0x7c, 0xbc, 0x3e, 0x66, 0xc6,
+    0x19, 0x32, 0xd2, 0x3e, 0x46, 0x25, 0x2d, 0x56, 0x9f, 0x58, 0x9d, 0x09, 0x32, 0x64, 0xb1, 0x7e,
+    0x59, 0xff, 0x7a, 0x5a, 0xc0, 0x6f, 0xf3, 0xd5, 0xc0, 0x1a, 0xa9, 0x6b, 0x45, 0x39, 0xc6, 0x85,
+    0x35, 0xee, 0x0d, 0x02, 0xda, 0x8a, 0x45, 0xea, 0x2d, 0xc6, 0x06, 0x31, 0xf5, 0x68, 0x02, 0x6e,
+    0x2b, 0x56, 0x0e, 0x0d, 0xa5, 0xe5, 0x2a, 0x46, 0x56, 0x8b, 0x72, 0xe4, 0xf4, 0xc7, 0xeb, 0x3e,
+    0xc1, 0x36, 0x8b, 0x7a, 0x2d, 0x0f, 0xa8, 0x53, 0x78, 0x91, 0x9e, 0x2d, 0x18, 0x5d, 0xb1, 0xc0,
+    0xea, 0x95, 0x77, 0x0e, 0x15, 0x19, 0xb7, 0x03, 0xf2, 0xd0, 0xfb, 0x2e, 0x80, 0x43, 0x3a, 0xfa,
+    0xf0, 0xc6, 0x39, 0x17, 0x65, 0x9b, 0x72, 0xa3, 0x0a, 0xa6, 0xa5, 0x3a, 0x3b, 0xc8, 0x00, 0xa1,
+    0x4a, 0xea, 0xbb, 0x7d, 0xd2, 0xc3, 0x77, 0x48, 0x2f, 0x16, 0x87, 0xeb, 0x97, 0xfe, 0xbb, 0xce,
+    0x13, 0x58, 0x31, 0x73, 0xd5, 0x7c, 0x99, 0x6d, 0x3b, 0x97, 0x00, 0xbd, 0x83, 0x36, 0x2f, 0xce,
+    0x5b, 0x24, 0xd5, 0xe4, 0xac, 0x8c, 0x24, 0xa9, 0x8b, 0xac, 0xe0, 0xd4, 0xa0, 0xcb, 0xa7, 0x94,
+    0xfc, 0x54, 0x9c, 0x43, 0xd2, 0x17, 0x1c, 0x9c, 0xf8, 0x6b, 0x4c, 0x81, 0xe2, 0xf2, 0x31, 0x25,
+    0x16, 0xe7, 0xcc, 0x6c, 0xf3, 0xc8, 0x13, 0x44, 0x55, 0x31, 0x35, 0x12, 0x46, 0xcd, 0x52, 0x29,
+    0x27, 0x3c, 0xd1, 0x6a, 0x32, 0x78, 0x35, 0x7d, 0xdd, 0xc1, 0xa6, 0x41, 0x88, 0x83, 0x71, 0x93,
+    0x1a, 0x38, 0x1a, 0x6b, 0xc1, 0xf9, 0x23, 0x28, 0xeb, 0x23, 0x72, 0xb6, 0x1c, 0xfb, 0x5e, 0xfe,
+    0xc7, 0xde, 0x4a, 0x63, 0x6f, 0xc0, 0x26, 0x41, 0x85, 0x6f, 0x9b, 0x9f, 0x3f, 0x06, 0xd8, 0xce,
+    0xea, 0x54, 0x4a, 0x70, 0xeb, 0xcd, 0x41, 0xc8, 0xd1, 0xf2, 0xfb, 0xf2, 0xbe, 0xde, 0x84, 0x1e,
+    0xe4, 0x4e, 0x1a, 0x27, 0x4a, 0x59, 0xbf, 0x83, 0x7d, 0x78, 0x70, 0xe2, 0xf3, 0xbc, 0x48, 0x3c,
+    0x36, 0x66, 0x8f, 0xbe, 0xa3, 0xbc, 0x9d, 0x3d, 0xcf, 0xe7, 0x83, 0x44, 0x25, 0x07, 0x5b, 0xfe,
+    0x69, 0x4c, 0x12, 0x3f, 0x68, 0x59, 0xbf, 0x23, 0x7f, 0xe5, 0xac, 0xf9, 0x55, 0xd6, 0xb8, 0x40,
+    0x60, 0xe2, 0x44, 0x27, 0xcd, 0x8e, 0xb3, 0x4b, 0x71, 0xc9, 0x92, 0xdf, 0xcb, 0x4c, 0x94, 0xd3,
+    0xbc, 0x44, 0x79, 0x9d, 0x7d, 0x9a, 0xf8, 0xb0, 0xa2, 0xd9, 0x5f, 0x4c, 0x96, 0xa8, 0xda, 0xb9,
+    0x02, 0x00, 0x00,
+};
+
+// portal.css: 175 -> 152 bytes
+static const uint8_t asset_portal_css[152] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x3d, 0x8e, 0x4b, 0x0a, 0xc4, 0x20,
+    0x10, 0x44, 0xf7, 0x9e, 0x22, 0x30, 0xcc, 0xd2, 0xa0, 0x81, 0x19, 0x06, 0x73, 0x1a, 0xc5, 0x4f,
+    0x1a, 0xa2, 0x06, 0xed, 0x90, 0x8f, 0x78, 0xf7, 0x31, 0x04, 0xb2, 0xac, 0xaa, 0x57, 0xdd, 0xa5,
+    0xa2, 0x3e, 0x8a, 0x8d, 0x01, 0xa9, 0x95, 0x1e, 0xe6, 0x43, 0x64, 0x19, 0x32, 0xcd, 0x26, 0x81,
+    0x1d, 0xbd, 0x4c, 0x0e, 0x82, 0xe0, 0xc6, 0x77, 0x72, 0xc5, 0xd8, 0xf4, 0x4e, 0x37, 0xd0, 0x38,
+    0x89, 0xe1, 0x67, 0xfc, 0xb8, 0x48, 0xad, 0x21, 0x38, 0xc1, 0xba, 0x46, 0x54, 0x02, 0x61, 0x59,
+    0xb1, 0xdc, 0x39, 0x67, 0xec, 0xfd, 0xe4, 0xfd, 0xa7, 0xc1, 0x2a, 0xee, 0x34, 0xc3, 0x79, 0x69,
+    0x15, 0x93, 0x36, 0x89, 0x36, 0xa7, 0x12, 0xb5, 0x22, 0xc6, 0x50, 0x1e, 0xf4, 0xdb, 0x7e, 0xf1,
+    0x7e, 0xb8, 0xee, 0xbd, 0xd2, 0xbd, 0x6b, 0x33, 0xe0, 0x26, 0x6c, 0xad, 0x59, 0x57, 0xf2, 0x07,
+    0xdf, 0x94, 0x51, 0xf5, 0xaf, 0x00, 0x00, 0x00,
+};
+
+// portal.js: 871 -> 441 bytes
+static const uint8_t asset_portal_js[441] = {
+    0x1f, 0x8b, 0x08, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x03, 0x9d, 0x52, 0x4d, 0x6f, 0x9b, 0x40,
+    0x10, 0xbd, 0xf3, 0x2b, 0xf0, 0x69, 0x76, 0x15, 0xb4, 0xb5, 0x72, 0xa9, 0x64, 0xc4, 0x25, 0x1f,
+    0x55, 0x22, 0x25, 0x6a, 0xd4, 0xb8, 0x3f, 0x60, 0xcd, 0x0e, 0x06, 0x0b, 0x76, 0xd1, 0xee, 0xe0,
+    0x3a, 0xc2, 0xfe, 0xef, 0x9d, 0x8d, 0x49, 0x83, 0xaa, 0xe4, 0xd0, 0x9e, 0x60, 0x86, 0xe1, 0xbd,
+    0x37, 0x6f, 0xde, 0x5e, 0xfb, 0xb4, 0x2a, 0x8c, 0x2b, 0x87, 0x0e, 0x2d, 0xa9, 0x2d, 0xd2, 0x6d,
+    0x8b, 0xf1, 0xf5, 0xea, 0xe5, 0xde, 0x08, 0x20, 0x90, 0x99, 0xff, 0xfc, 0xb3, 0x07, 0x99, 0x27,
+    0xd5, 0x60, 0x4b, 0x6a, 0x9c, 0x4d, 0x7b, 0xd7, 0xb6, 0xa2, 0x31, 0x72, 0xac, 0x90, 0xca, 0x5a,
+    0xc0, 0x97, 0x40, 0x9a, 0x86, 0x00, 0x52, 0x51, 0x8d, 0x56, 0xbc, 0xcd, 0x89, 0x83, 0x1c, 0x3d,
+    0xd2, 0xe0, 0x6d, 0x7a, 0x50, 0xbb, 0xc0, 0x0d, 0x79, 0xfa, 0x7b, 0x24, 0xc8, 0x31, 0x69, 0x2a,
+    0xb1, 0x08, 0x8a, 0x30, 0xd0, 0xf1, 0x78, 0x7e, 0xaa, 0x9d, 0xdb, 0x2c, 0x0a, 0x66, 0x38, 0xff,
+    0x9e, 0x7b, 0xee, 0x1e, 0xe8, 0xda, 0x59, 0x62, 0x45, 0x05, 0xac, 0x79, 0x64, 0x95, 0xc2, 0xc5,
+    0x34, 0x1c, 0xd9, 0x31, 0x8f, 0x30, 0xf3, 0x46, 0x51, 0x80, 0x1f, 0xac, 0x6d, 0xec, 0x16, 0x64,
+    0x40, 0x5a, 0x37, 0x1d, 0xba, 0x81, 0xde, 0x99, 0xe5, 0xf8, 0xb6, 0xc6, 0x29, 0xfb, 0xba, 0x5c,
+    0xb2, 0xb4, 0x53, 0x52, 0x29, 0x67, 0xc3, 0xb0, 0xe9, 0x1a, 0x2a, 0xfe, 0xcc, 0xa1, 0x1c, 0x51,
+    0xf5, 0x1e, 0xf7, 0x4c, 0x7d, 0x83, 0x95, 0x1e, 0x5a, 0x12, 0xf2, 0x23, 0x45, 0xcc, 0xa4, 0x94,
+    0x02, 0xf6, 0x69, 0x72, 0x25, 0x6a, 0x81, 0x6c, 0xec, 0x90, 0x6a, 0x67, 0x56, 0xf0, 0xf4, 0xfd,
+    0x79, 0x0d, 0xd9, 0xc6, 0x99, 0x97, 0x95, 0xc5, 0x5f, 0xe9, 0xcf, 0x1f, 0x0f, 0xcf, 0xa8, 0x7d,
+    0x59, 0x3f, 0x69, 0xaf, 0xbb, 0x20, 0x62, 0xef, 0x9b, 0xf3, 0xdd, 0x8d, 0x26, 0x2d, 0x2a, 0xc9,
+    0x7a, 0x92, 0x7f, 0xb7, 0x73, 0x37, 0x6d, 0xb5, 0x8b, 0x0e, 0xbe, 0x42, 0x94, 0x3a, 0x8a, 0x99,
+    0x6d, 0xfd, 0xa1, 0x97, 0xe8, 0xbd, 0xf3, 0xc0, 0x16, 0xcc, 0xae, 0xac, 0xfb, 0x20, 0x66, 0x27,
+    0x2e, 0xb5, 0xfd, 0xdf, 0x03, 0xef, 0x39, 0x7b, 0xe6, 0xf3, 0x70, 0x31, 0x11, 0xc7, 0xcb, 0xa8,
+    0xc6, 0x5a, 0xf4, 0x77, 0xeb, 0xc7, 0x87, 0x02, 0x20, 0x0f, 0x8a, 0xdb, 0xaa, 0x72, 0xfe, 0x56,
+    0xcf, 0xf5, 0xeb, 0x09, 0xce, 0xbd, 0xc3, 0x95, 0x1e, 0xf9, 0xdc, 0x13, 0xa2, 0x00, 0xd7, 0xc7,
+    0x41, 0x06, 0x74, 0x6a, 0xaf, 0xdb, 0x01, 0x0b, 0xad, 0x42, 0x68, 0x0c, 0x97, 0xad, 0xde, 0x60,
+    0xcb, 0xa5, 0xe7, 0xfa, 0x02, 0x52, 0x73, 0xd5, 0x01, 0xb3, 0xea, 0xbe, 0x47, 0x6b, 0xae, 0xeb,
+    0xa6, 0x35, 0xc2, 0xb1, 0xfe, 0x29, 0x48, 0x71, 0xdf, 0x18, 0x9e, 0xe3, 0x71, 0x71, 0x96, 0xd2,
+    0xa2, 0xdd, 0x52, 0x3d, 0x8f, 0x12, 0x77, 0xb3, 0xcb, 0xe5, 0x14, 0x9d, 0x57, 0xb7, 0xf2, 0xe4,
+    0x37, 0xaa, 0x55, 0x01, 0x40, 0x67, 0x03, 0x00, 0x00,
+};
+
+const portal_asset_t PORTAL_ASSETS[] = {
+    { "/", "text/html", asset_index_html, 410, "\"32ea030bf8e1c715\"", "no-cache" },
+    { "/saved.html", "text/html", asset_saved_html, 451, "\"bb1de4cf4e11d9ab\"", "no-cache" },
+    { "/portal.css", "text/css", asset_portal_css, 152, "\"4dd33b8208646df5\"", "public, max-age=86400" },
+    { "/portal.js", "application/javascript", asset_portal_js, 441, "\"874a4bb427aa1c00\"", "public, max-age=86400" },
+};
+
+const size_t PORTAL_ASSET_COUNT = sizeof(PORTAL_ASSETS) / sizeof(PORTAL_ASSETS[0]);
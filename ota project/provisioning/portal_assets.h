@@ -0,0 +1,21 @@
+#ifndef PORTAL_ASSETS_H
+#define PORTAL_ASSETS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Gzip-precompressed portal asset, stored in flash (.rodata)
+typedef struct {
+    const char *uri;
+    const char *type;
+    const uint8_t *gz;
+    size_t gz_len;
+    const char *etag;
+    const char *cache_control;
+} portal_asset_t;
+
+// Generated into portal_assets.c by tools/gen_portal_assets.py
+extern const portal_asset_t PORTAL_ASSETS[];
+extern const size_t PORTAL_ASSET_COUNT;
+
+#endif
@@ -1,13 +1,18 @@
 #include "provisioning_manager.h"
+#include "portal_assets.h"
+#include "dns_responder.h"
 
 #include "config/provisioning_config.h"
 #include "storage/wifi_nvs.h"
+#include "storage/mem_monitor.h"
+#include "network/wifi_manager.h"
 
 #include "esp_wifi.h"
 #include "esp_event.h"
 #include "esp_log.h"
 #include "esp_http_server.h"
 #include "esp_netif.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 
@@ -26,37 +31,117 @@ static esp_netif_t *g_ap_netif = NULL;
 
 static TaskHandle_t g_dns_task = NULL;
 static TaskHandle_t g_timeout_task = NULL;
+static TaskHandle_t g_release_task = NULL;
 
 static volatile bool g_done = false;
 static volatile bool g_failed = false;
+static volatile bool g_stop = false;            // asks DNS/timeout tasks to exit
+static volatile bool g_handoff = false;         // creds saved, STA connecting under the portal
+static volatile bool g_handoff_failed = false;  // last handoff attempt failed (portal reopened)
+static volatile uint32_t g_dns_dropped = 0;
 
 static volatile int64_t g_start_ms = 0;
 
+/* Network test job: driven by Wi-Fi/IP events, polled through /status */
+typedef enum {
+    TEST_IDLE = 0,
+    TEST_RUNNING,
+    TEST_OK,
+    TEST_FAIL
+} test_state_t;
+
+typedef struct {
+    uint32_t id;
+    test_state_t state;
+    char ssid[32];
+    int64_t start_ms;
+    int64_t end_ms;
+    uint8_t reason;         // wifi_err_reason_t on failure, 0 = timeout
+} test_job_t;
+
+#define TEST_TIMEOUT_MS     8000
+
+static test_job_t g_test;
+static portMUX_TYPE g_test_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t g_test_timer = NULL;
+static esp_event_handler_instance_t g_wifi_evt = NULL;
+static esp_event_handler_instance_t g_ip_evt = NULL;
+
+/* Scan cache: refreshed in the background, served by /scan without waiting */
+typedef struct {
+    char ssid[33];
+    int8_t rssi;
+    uint8_t channel;
+    uint8_t auth;           // wifi_auth_mode_t
+} scan_entry_t;
+
+static scan_entry_t g_scan[PROV_SCAN_MAX_AP];
+static int g_scan_count = 0;
+static int64_t g_scan_ms = 0;           // time of last completed scan (0 = none)
+static volatile bool g_scan_busy = false;
+static portMUX_TYPE g_scan_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t g_scan_timer = NULL;
+static esp_event_handler_instance_t g_scan_evt = NULL;
+static wifi_ap_record_t g_scan_recs[PROV_SCAN_MAX_AP * 2];   // raw results, only touched in the event task
+
 // simple helpers
 static int64_t now_ms(void)
 {
     return (int64_t)(esp_timer_get_time() / 1000);
 }
 
-/* ---------------- Captive Portal HTML ---------------- */
-
-static const char *HTML_PAGE =
-"<!doctype html><html><head><meta name='viewport' content='width=device-width,initial-scale=1'>"
-"<title>ESP32 WiFi Setup</title></head><body>"
-"<h2>ESP32 WiFi Provisioning</h2>"
-"<form method='POST' action='/save'>"
-"<label>SSID</label><br><input name='ssid' maxlength='32' required><br><br>"
-"<label>Password</label><br><input name='pass' type='password' maxlength='64' required><br><br>"
-"<button type='submit'>Save</button>"
-"</form><hr>"
-"<h3>Network Test</h3>"
-"<form method='POST' action='/test'>"
-"<label>SSID</label><br><input name='ssid' maxlength='32' required><br><br>"
-"<label>Password</label><br><input name='pass' type='password' maxlength='64' required><br><br>"
-"<button type='submit'>Test Connect</button>"
-"</form>"
-"<p><a href='/status'>Status</a></p>"
-"</body></html>";
+// STA side as seen by the phone during handoff
+static const char *sta_state_str(void)
+{
+    if (!g_handoff) return g_handoff_failed ? "failed" : "idle";
+    if (wifi_is_connected()) return "connected";
+    if (wifi_has_failed()) return "failed";
+    return "connecting";
+}
+
+static const char *test_state_str(test_state_t s)
+{
+    switch (s)
+    {
+        case TEST_RUNNING: return "running";
+        case TEST_OK:      return "ok";
+        case TEST_FAIL:    return "fail";
+        default:           return "idle";
+    }
+}
+
+// Copies s into out as JSON string content (no quotes added)
+static void json_escape(const char *s, char *out, size_t out_sz)
+{
+    size_t o = 0;
+    for (; *s && o + 7 < out_sz; s++)
+    {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') { out[o++] = '\\'; out[o++] = (char)c; }
+        else if (c < 0x20) o += (size_t)snprintf(&out[o], out_sz - o, "\\u%04x", c);
+        else out[o++] = (char)c;
+    }
+    out[o] = '\0';
+}
+
+/* ---------------- Captive Portal Probes ----------------
+   OS connectivity checks. While provisioning they get a bare 302 to the
+   portal (which opens the sign-in sheet); once done, a 204 so the phone
+   treats the network as usable and closes it.
+*/
+
+static const char *PROBE_URIS[] = {
+    "/generate_204",                // Android
+    "/gen_204",
+    "/hotspot-detect.html",         // Apple
+    "/library/test/success.html",
+    "/connecttest.txt",             // Windows
+    "/ncsi.txt",
+    "/canonical.html",              // Firefox
+    "/success.txt",
+};
+
+#define PORTAL_URL  "http://" PROV_AP_IP_ADDR "/"
 
 /* ---------------- HTTP Utils ---------------- */
 
@@ -101,25 +186,76 @@ static bool form_get_field(const char *body, const char *key, char *out, size_t
 
 /* ---------------- HTTP Handlers ---------------- */
 
-static esp_err_t handle_root(httpd_req_t *req)
+// Serves a precompressed asset straight from flash (no copy, no gzip at runtime)
+static esp_err_t handle_asset(httpd_req_t *req)
 {
-    httpd_resp_set_type(req, "text/html");
-    httpd_resp_send(req, HTML_PAGE, HTTPD_RESP_USE_STRLEN);
-    return ESP_OK;
+    const portal_asset_t *a = (const portal_asset_t*)req->user_ctx;
+
+    httpd_resp_set_hdr(req, "ETag", a->etag);
+    httpd_resp_set_hdr(req, "Cache-Control", a->cache_control);
+
+    char inm[24];
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", inm, sizeof(inm)) == ESP_OK &&
+        strcmp(inm, a->etag) == 0)
+    {
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_type(req, a->type);
+    httpd_resp_set_hdr(req, "Content-Encoding", "gzip");
+    return httpd_resp_send(req, (const char*)a->gz, (ssize_t)a->gz_len);
+}
+
+static bool is_probe_uri(const char *uri)
+{
+    size_t n = strcspn(uri, "?");
+    for (size_t i = 0; i < sizeof(PROBE_URIS) / sizeof(PROBE_URIS[0]); i++)
+    {
+        if (strlen(PROBE_URIS[i]) == n && strncmp(uri, PROBE_URIS[i], n) == 0) return true;
+    }
+    return false;
+}
+
+// Wildcard: connectivity probes and unknown paths get a bodiless redirect
+static esp_err_t handle_any(httpd_req_t *req)
+{
+    if (g_done && is_probe_uri(req->uri))
+    {
+        httpd_resp_set_status(req, "204 No Content");
+        return httpd_resp_send(req, NULL, 0);
+    }
+
+    httpd_resp_set_status(req, "302 Found");
+    httpd_resp_set_hdr(req, "Location", PORTAL_URL);
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+    return httpd_resp_send(req, NULL, 0);
 }
 
 static esp_err_t handle_status(httpd_req_t *req)
 {
-    char buf[256];
-    int64_t elapsed = now_ms() - g_start_ms;
+    char buf[384];
+    int64_t now = now_ms();
+    int64_t elapsed = now - g_start_ms;
     int64_t left = (PROV_TIMEOUT_MS - elapsed);
     if (left < 0) left = 0;
 
+    test_job_t t;
+    portENTER_CRITICAL(&g_test_mux);
+    t = g_test;
+    portEXIT_CRITICAL(&g_test_mux);
+
+    int64_t t_ms = (t.state == TEST_RUNNING) ? (now - t.start_ms) : (t.end_ms - t.start_ms);
+    if (t.state == TEST_IDLE) t_ms = 0;
+
     snprintf(buf, sizeof(buf),
-             "{ \"done\": %s, \"failed\": %s, \"ms_left\": %lld }",
+             "{ \"done\": %s, \"failed\": %s, \"ms_left\": %lld, \"sta\": \"%s\", "
+             "\"test\": { \"job\": %u, \"state\": \"%s\", \"ssid\": \"%s\", \"ms\": %lld, \"reason\": %u } }",
              g_done ? "true" : "false",
              g_failed ? "true" : "false",
-             (long long)left);
+             (long long)left,
+             sta_state_str(),
+             (unsigned)t.id, test_state_str(t.state), t.ssid, (long long)t_ms, (unsigned)t.reason);
 
     httpd_resp_set_type(req, "application/json");
     httpd_resp_send(req, buf, HTTPD_RESP_USE_STRLEN);
@@ -143,7 +279,7 @@ static esp_err_t handle_save(httpd_req_t *req)
         return ESP_OK;
     }
 
-    if (!wifi_nvs_save_creds(ssid, pass))
+    if (!wifi_nvs_add_net(ssid, pass))
     {
         g_failed = true;
         httpd_resp_sendstr(req, "Failed to save credentials");
@@ -151,12 +287,221 @@ static esp_err_t handle_save(httpd_req_t *req)
     }
 
     g_done = true;
-    httpd_resp_sendstr(req, "Saved! You can close this page. Device will connect.");
-    ESP_LOGI(TAG, "Saved creds to NVS (ssid=%s)", ssid);
-    return ESP_OK;
+    ESP_LOGI(TAG, "Added network to NVS (ssid=%s)", ssid);
+
+    // Post/Redirect/Get: the result page polls /status while the STA connects
+    httpd_resp_set_status(req, "303 See Other");
+    httpd_resp_set_hdr(req, "Location", "/saved.html");
+    return httpd_resp_send(req, NULL, 0);
+}
+
+/* ---------------- Background Scan ---------------- */
+
+// Starts a scan unless one is already running or a network test owns the STA.
+// Short per-channel dwell plus home-channel returns keep AP beacons flowing.
+static void scan_kick(void)
+{
+    bool start = false;
+
+    // g_test.state belongs to g_test_mux; always taken inside g_scan_mux
+    portENTER_CRITICAL(&g_scan_mux);
+    portENTER_CRITICAL(&g_test_mux);
+    bool testing = (g_test.state == TEST_RUNNING);
+    portEXIT_CRITICAL(&g_test_mux);
+    if (!g_scan_busy && !testing)
+    {
+        g_scan_busy = true;
+        start = true;
+    }
+    portEXIT_CRITICAL(&g_scan_mux);
+
+    if (!start) return;
+
+    wifi_scan_config_t sc = {0};
+    sc.scan_type = WIFI_SCAN_TYPE_ACTIVE;
+    sc.scan_time.active.min = 0;
+    sc.scan_time.active.max = PROV_SCAN_DWELL_MS;
+    sc.home_chan_dwell_time = PROV_SCAN_HOME_DWELL_MS;
+
+    if (esp_wifi_scan_start(&sc, false) != ESP_OK)
+    {
+        ESP_LOGW(TAG, "Scan start failed");
+        g_scan_busy = false;
+    }
+}
+
+static void scan_timer_cb(void *arg)
+{
+    (void)arg;
+    scan_kick();
+}
+
+// Dedupe by SSID (strongest BSS wins), drop hidden networks, sort by RSSI
+static void scan_collect(void)
+{
+    uint16_t n = sizeof(g_scan_recs) / sizeof(g_scan_recs[0]);
+    if (esp_wifi_scan_get_ap_records(&n, g_scan_recs) != ESP_OK) n = 0;
+
+    scan_entry_t tmp[PROV_SCAN_MAX_AP];
+    int count = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        const wifi_ap_record_t *r = &g_scan_recs[i];
+        if (r->ssid[0] == 0) continue;
+
+        int j = 0;
+        while (j < count && strcmp(tmp[j].ssid, (const char*)r->ssid) != 0) j++;
+
+        if (j < count)
+        {
+            if (r->rssi <= tmp[j].rssi) continue;
+        }
+        else if (count < PROV_SCAN_MAX_AP)
+        {
+            count++;
+        }
+        else
+        {
+            // Full: replace the weakest entry if this one is stronger
+            j = 0;
+            for (int k = 1; k < count; k++) if (tmp[k].rssi < tmp[j].rssi) j = k;
+            if (r->rssi <= tmp[j].rssi) continue;
+        }
+
+        snprintf(tmp[j].ssid, sizeof(tmp[j].ssid), "%s", (const char*)r->ssid);
+        tmp[j].rssi = r->rssi;
+        tmp[j].channel = r->primary;
+        tmp[j].auth = (uint8_t)r->authmode;
+    }
+
+    // Insertion sort, strongest first (n is small)
+    for (int i = 1; i < count; i++)
+    {
+        scan_entry_t e = tmp[i];
+        int j = i;
+        while (j > 0 && tmp[j - 1].rssi < e.rssi) { tmp[j] = tmp[j - 1]; j--; }
+        tmp[j] = e;
+    }
+
+    portENTER_CRITICAL(&g_scan_mux);
+    memcpy(g_scan, tmp, sizeof(tmp[0]) * (size_t)count);
+    g_scan_count = count;
+    g_scan_ms = now_ms();
+    g_scan_busy = false;
+    portEXIT_CRITICAL(&g_scan_mux);
+
+    ESP_LOGI(TAG, "Scan cache: %d networks (%u results)", count, (unsigned)n);
+}
+
+static void scan_event_handler(void *arg,
+                               esp_event_base_t event_base,
+                               int32_t event_id,
+                               void *event_data)
+{
+    (void)arg; (void)event_base; (void)event_id; (void)event_data;
+    if (g_scan_busy) scan_collect();
+}
+
+// Returns the cached list immediately; ?refresh=1 asks for a background rescan
+static esp_err_t handle_scan(httpd_req_t *req)
+{
+    char query[32];
+    char val[4];
+    bool refresh = false;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "refresh", val, sizeof(val)) == ESP_OK)
+    {
+        refresh = (val[0] == '1');
+    }
+
+    scan_entry_t snap[PROV_SCAN_MAX_AP];
+    int count;
+    int64_t scan_ms;
+
+    portENTER_CRITICAL(&g_scan_mux);
+    count = g_scan_count;
+    scan_ms = g_scan_ms;
+    memcpy(snap, g_scan, sizeof(snap[0]) * (size_t)count);
+    portEXIT_CRITICAL(&g_scan_mux);
+
+    int64_t age = scan_ms ? (now_ms() - scan_ms) : -1;
+    if (refresh && (age < 0 || age > PROV_SCAN_MIN_INTERVAL_MS)) scan_kick();
+
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_set_hdr(req, "Cache-Control", "no-store");
+
+    char line[128];
+    char esc[33 * 6];
+    snprintf(line, sizeof(line), "{ \"scanning\": %s, \"age_ms\": %lld, \"aps\": [",
+             g_scan_busy ? "true" : "false", (long long)age);
+    httpd_resp_sendstr_chunk(req, line);
+
+    for (int i = 0; i < count; i++)
+    {
+        json_escape(snap[i].ssid, esc, sizeof(esc));
+        httpd_resp_sendstr_chunk(req, i ? "," : "");
+        httpd_resp_sendstr_chunk(req, "{\"ssid\":\"");
+        httpd_resp_sendstr_chunk(req, esc);
+        snprintf(line, sizeof(line), "\",\"rssi\":%d,\"ch\":%u,\"open\":%s}",
+                 snap[i].rssi, snap[i].channel, snap[i].auth == WIFI_AUTH_OPEN ? "true" : "false");
+        httpd_resp_sendstr_chunk(req, line);
+    }
+
+    httpd_resp_sendstr_chunk(req, "] }");
+    return httpd_resp_sendstr_chunk(req, NULL);
+}
+
+/* ---------------- Network Test Job ---------------- */
+
+static void test_finish(test_state_t state, uint8_t reason)
+{
+    bool finished = false;
+
+    portENTER_CRITICAL(&g_test_mux);
+    if (g_test.state == TEST_RUNNING)
+    {
+        g_test.state = state;
+        g_test.reason = reason;
+        g_test.end_ms = now_ms();
+        finished = true;
+    }
+    portEXIT_CRITICAL(&g_test_mux);
+
+    if (!finished) return;
+
+    esp_timer_stop(g_test_timer);
+    // Leave the STA idle; the AP keeps running in APSTA mode throughout
+    esp_wifi_disconnect();
+    ESP_LOGI(TAG, "Test job %u: %s (reason=%u)", (unsigned)g_test.id, test_state_str(state), reason);
+}
+
+static void test_timer_cb(void *arg)
+{
+    (void)arg;
+    test_finish(TEST_FAIL, 0);
+}
+
+static void test_event_handler(void *arg,
+                               esp_event_base_t event_base,
+                               int32_t event_id,
+                               void *event_data)
+{
+    (void)arg;
+
+    if (event_base == IP_EVENT && event_id == IP_EVENT_STA_GOT_IP)
+    {
+        test_finish(TEST_OK, 0);
+    }
+    else if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_DISCONNECTED)
+    {
+        wifi_event_sta_disconnected_t *d = (wifi_event_sta_disconnected_t*)event_data;
+        test_finish(TEST_FAIL, d ? d->reason : 0);
+    }
 }
 
-// Simple “network test”: attempt STA connect quickly with provided creds and report success/fail.
+// Starts a STA connect with the given creds and returns the job id at once.
+// Progress/result are reported by /status.
 static esp_err_t handle_test(httpd_req_t *req)
 {
     char body[512] = {0};
@@ -174,35 +519,55 @@ static esp_err_t handle_test(httpd_req_t *req)
         return ESP_OK;
     }
 
-    // Try connect in STA mode (temporary)
-    wifi_config_t sta = {0};
-    strncpy((char*)sta.sta.ssid, ssid, sizeof(sta.sta.ssid) - 1);
-    strncpy((char*)sta.sta.password, pass, sizeof(sta.sta.password) - 1);
+    char resp[64];
+    bool busy = false;
+    uint32_t id = 0;
 
-    esp_wifi_set_mode(WIFI_MODE_APSTA);
-    esp_wifi_set_config(WIFI_IF_STA, &sta);
-    esp_wifi_connect();
+    portENTER_CRITICAL(&g_test_mux);
+    if (g_test.state == TEST_RUNNING)
+    {
+        busy = true;
+        id = g_test.id;
+    }
+    else
+    {
+        id = ++g_test.id;
+        g_test.state = TEST_RUNNING;
+        g_test.reason = 0;
+        g_test.start_ms = now_ms();
+        g_test.end_ms = 0;
+        // Display copy only: keep it safe to embed in the /status JSON
+        for (size_t i = 0; i < sizeof(g_test.ssid); i++)
+        {
+            char c = ssid[i];
+            g_test.ssid[i] = (c == '"' || c == '\\' || (c != 0 && (unsigned char)c < 0x20)) ? '?' : c;
+        }
+    }
+    portEXIT_CRITICAL(&g_test_mux);
 
-    // Wait up to 8 seconds for IP (simple test)
-    bool ok = false;
-    for (int i = 0; i < 16; i++)
+    if (!busy)
     {
-        vTaskDelay(pdMS_TO_TICKS(500));
-        // We check by querying STA netif IP (best-effort without extra event wiring)
-        esp_netif_ip_info_t ip;
-        esp_netif_t *sta_netif = esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
-        if (sta_netif && esp_netif_get_ip_info(sta_netif, &ip) == ESP_OK)
+        // The STA is needed for the test: abandon a background scan in flight
+        if (g_scan_busy)
         {
-            if (ip.ip.addr != 0) { ok = true; break; }
+            esp_wifi_scan_stop();
+            g_scan_busy = false;
         }
+
+        wifi_config_t sta = {0};
+        strncpy((char*)sta.sta.ssid, ssid, sizeof(sta.sta.ssid) - 1);
+        strncpy((char*)sta.sta.password, pass, sizeof(sta.sta.password) - 1);
+
+        esp_wifi_set_config(WIFI_IF_STA, &sta);
+        esp_timer_start_once(g_test_timer, (uint64_t)TEST_TIMEOUT_MS * 1000ULL);
+        if (esp_wifi_connect() != ESP_OK) test_finish(TEST_FAIL, 0);
     }
 
-    // Return to AP-only (keep portal alive)
-    esp_wifi_disconnect();
-    esp_wifi_set_mode(WIFI_MODE_AP);
+    snprintf(resp, sizeof(resp), "{ \"job\": %u, \"state\": \"%s\" }",
+             (unsigned)id, busy ? "busy" : "running");
 
-    httpd_resp_set_type(req, "text/plain");
-    httpd_resp_sendstr(req, ok ? "TEST_OK: Connected and got IP" : "TEST_FAIL: Could not get IP");
+    httpd_resp_set_type(req, "application/json");
+    httpd_resp_sendstr(req, resp);
     return ESP_OK;
 }
 
@@ -212,21 +577,29 @@ static void http_start(void)
 {
     httpd_config_t cfg = HTTPD_DEFAULT_CONFIG();
     cfg.uri_match_fn = httpd_uri_match_wildcard;   // helps captive portal style paths
+    cfg.lru_purge_enable = true;                   // many phones probe at once; recycle idle sockets
+    cfg.max_uri_handlers = 12;
 
     ESP_ERROR_CHECK(httpd_start(&g_http, &cfg));
 
-    httpd_uri_t root = {.uri="/", .method=HTTP_GET, .handler=handle_root};
     httpd_uri_t status = {.uri="/status", .method=HTTP_GET, .handler=handle_status};
     httpd_uri_t save = {.uri="/save", .method=HTTP_POST, .handler=handle_save};
     httpd_uri_t test = {.uri="/test", .method=HTTP_POST, .handler=handle_test};
+    httpd_uri_t scan = {.uri="/scan", .method=HTTP_GET, .handler=handle_scan};
 
-    httpd_register_uri_handler(g_http, &root);
+    for (size_t i = 0; i < PORTAL_ASSET_COUNT; i++)
+    {
+        httpd_uri_t asset = {.uri=PORTAL_ASSETS[i].uri, .method=HTTP_GET,
+                             .handler=handle_asset, .user_ctx=(void*)&PORTAL_ASSETS[i]};
+        httpd_register_uri_handler(g_http, &asset);
+    }
     httpd_register_uri_handler(g_http, &status);
     httpd_register_uri_handler(g_http, &save);
     httpd_register_uri_handler(g_http, &test);
+    httpd_register_uri_handler(g_http, &scan);
 
-    // Wildcard handler: any unknown path redirects to "/"
-    httpd_uri_t any = {.uri="/*", .method=HTTP_GET, .handler=handle_root};
+    // Wildcard handler: probes and unknown paths redirect to "/"
+    httpd_uri_t any = {.uri="/*", .method=HTTP_GET, .handler=handle_any};
     httpd_register_uri_handler(g_http, &any);
 
     ESP_LOGI(TAG, "HTTP portal started");
@@ -260,43 +633,34 @@ static void softap_start(void)
     ESP_ERROR_CHECK(esp_netif_set_ip_info(g_ap_netif, &ip));
     ESP_ERROR_CHECK(esp_netif_dhcps_start(g_ap_netif));
 
-    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_AP));
+    // APSTA from the start: the network test uses the STA side without
+    // switching modes (which would stall every portal client)
+    ESP_ERROR_CHECK(esp_wifi_set_mode(WIFI_MODE_APSTA));
     ESP_ERROR_CHECK(esp_wifi_set_config(WIFI_IF_AP, &ap_cfg));
     ESP_ERROR_CHECK(esp_wifi_start());
 
     ESP_LOGI(TAG, "SoftAP started SSID=%s IP=%s", PROV_AP_SSID, PROV_AP_IP_ADDR);
 }
 
-/* ---------------- Minimal DNS Server (wildcard A record) ----------------
-   Replies to any query with A=PROV_AP_IP_ADDR.
+/* ---------------- Captive DNS Server ----------------
+   Wildcard A record for every name (see dns_responder.c). select() with a
+   timeout lets provisioning_stop() end the task and close the socket.
 */
 
-#pragma pack(push, 1)
-typedef struct {
-    uint16_t id;
-    uint16_t flags;
-    uint16_t qdcount;
-    uint16_t ancount;
-    uint16_t nscount;
-    uint16_t arcount;
-} dns_hdr_t;
-#pragma pack(pop)
-
-static int dns_skip_qname(const uint8_t *msg, int len, int off)
-{
-    while (off < len && msg[off] != 0)
-    {
-        off += (int)msg[off] + 1;
-    }
-    return (off < len) ? off + 1 : len;
-}
-
 static void dns_task(void *arg)
 {
     (void)arg;
+    mem_monitor_task_enter(PROV_DNS_TASK_STACK);
 
     int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
-    if (sock < 0) { g_failed = true; vTaskDelete(NULL); }
+    if (sock < 0)
+    {
+        g_failed = true;
+        mem_monitor_task_exit();
+        g_dns_task = NULL;
+        vTaskDelete(NULL);
+        return;
+    }
 
     struct sockaddr_in addr = {0};
     addr.sin_family = AF_INET;
@@ -307,63 +671,44 @@ static void dns_task(void *arg)
     {
         close(sock);
         g_failed = true;
+        mem_monitor_task_exit();
+        g_dns_task = NULL;
         vTaskDelete(NULL);
+        return;
     }
 
-    uint8_t rx[512];
-    uint8_t tx[512];
+    dns_responder_init(ipaddr_addr(PROV_AP_IP_ADDR), PROV_DNS_TTL_S);
 
-    uint32_t ap_ip = ipaddr_addr(PROV_AP_IP_ADDR);
+    uint8_t buf[DNS_MAX_PACKET];
 
-    while (!g_done && !g_failed)
+    while (!g_stop)
     {
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        FD_SET(sock, &rfds);
+        struct timeval tv = { .tv_sec = 0, .tv_usec = PROV_DNS_POLL_MS * 1000 };
+
+        if (select(sock + 1, &rfds, NULL, NULL, &tv) <= 0) continue;
+
         struct sockaddr_in from = {0};
         socklen_t flen = sizeof(from);
-        int r = recvfrom(sock, rx, sizeof(rx), 0, (struct sockaddr*)&from, &flen);
+        int r = recvfrom(sock, buf, sizeof(buf), 0, (struct sockaddr*)&from, &flen);
         if (r <= 0) continue;
 
-        if (r < (int)sizeof(dns_hdr_t)) continue;
-
-        dns_hdr_t *h = (dns_hdr_t*)rx;
-        uint16_t qd = ntohs(h->qdcount);
-        if (qd == 0) continue;
-
-        // Copy question section
-        int off = sizeof(dns_hdr_t);
-        int qname_end = dns_skip_qname(rx, r, off);
-        if (qname_end + 4 > r) continue; // QTYPE+QCLASS
-
-        int qlen = (qname_end + 4) - off;
-
-        // Build response
-        memset(tx, 0, sizeof(tx));
-        dns_hdr_t *rh = (dns_hdr_t*)tx;
-        rh->id = h->id;
-        rh->flags = htons(0x8180); // standard query response, No error
-        rh->qdcount = htons(1);
-        rh->ancount = htons(1);
-
-        int toff = sizeof(dns_hdr_t);
-        memcpy(&tx[toff], &rx[off], qlen);
-        toff += qlen;
-
-        // Answer: name pointer to 0x0c
-        tx[toff++] = 0xC0; tx[toff++] = 0x0C;
-        // TYPE A, CLASS IN
-        tx[toff++] = 0x00; tx[toff++] = 0x01;
-        tx[toff++] = 0x00; tx[toff++] = 0x01;
-        // TTL 60s
-        tx[toff++] = 0x00; tx[toff++] = 0x00; tx[toff++] = 0x00; tx[toff++] = 0x3C;
-        // RDLENGTH 4
-        tx[toff++] = 0x00; tx[toff++] = 0x04;
-        // RDATA IP
-        memcpy(&tx[toff], &ap_ip, 4);
-        toff += 4;
+        if (!dns_rate_allow(from.sin_addr.s_addr, now_ms()))
+        {
+            g_dns_dropped++;
+            continue;
+        }
 
-        sendto(sock, tx, toff, 0, (struct sockaddr*)&from, flen);
+        int n = dns_responder_answer(buf, r, sizeof(buf));
+        if (n > 0) sendto(sock, buf, n, 0, (struct sockaddr*)&from, flen);
     }
 
     close(sock);
+    ESP_LOGI(TAG, "DNS stopped (rate-limited drops=%u)", (unsigned)g_dns_dropped);
+    mem_monitor_task_exit();
+    g_dns_task = NULL;
     vTaskDelete(NULL);
 }
 
@@ -372,16 +717,19 @@ static void dns_task(void *arg)
 static void timeout_task(void *arg)
 {
     (void)arg;
-    while (!g_done && !g_failed)
+    mem_monitor_task_enter(PROV_TIMEOUT_TASK_STACK);
+    while (!g_failed && !g_stop)
     {
         vTaskDelay(pdMS_TO_TICKS(250));
-        if ((now_ms() - g_start_ms) > PROV_TIMEOUT_MS)
+        if (!g_done && (now_ms() - g_start_ms) > PROV_TIMEOUT_MS)
         {
             ESP_LOGE(TAG, "Provisioning timeout");
             g_failed = true;
             break;
         }
     }
+    mem_monitor_task_exit();
+    g_timeout_task = NULL;
     vTaskDelete(NULL);
 }
 
@@ -389,33 +737,130 @@ static void timeout_task(void *arg)
 
 void provisioning_start(void)
 {
+    // A handoff release in flight is about to drop the AP: let it finish
+    for (int i = 0; g_release_task && i < (PROV_HANDOFF_LINGER_MS + 1000) / 50; i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(50));
+    }
+
+    if (g_ap_netif)
+    {
+        // Portal still up: reopen it rather than register and bind it twice
+        g_done = false;
+        g_failed = false;
+        g_handoff = false;
+        g_handoff_failed = false;
+        g_start_ms = now_ms();
+        esp_timer_stop(g_scan_timer);
+        esp_timer_start_periodic(g_scan_timer, (uint64_t)PROV_SCAN_REFRESH_MS * 1000ULL);
+        ESP_LOGI(TAG, "Provisioning already running, portal reopened");
+        return;
+    }
+
     g_done = false;
     g_failed = false;
+    g_stop = false;
+    g_handoff = false;
+    g_handoff_failed = false;
+    g_dns_dropped = 0;
 
     g_start_ms = now_ms();
 
+    memset(&g_test, 0, sizeof(g_test));
+    if (!g_test_timer)
+    {
+        esp_timer_create_args_t targs = {
+            .callback = test_timer_cb,
+            .name = "prov_test"
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&targs, &g_test_timer));
+    }
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, &test_event_handler, NULL, &g_wifi_evt));
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        IP_EVENT, IP_EVENT_STA_GOT_IP, &test_event_handler, NULL, &g_ip_evt));
+
+    g_scan_count = 0;
+    g_scan_ms = 0;
+    g_scan_busy = false;
+    if (!g_scan_timer)
+    {
+        esp_timer_create_args_t sargs = {
+            .callback = scan_timer_cb,
+            .name = "prov_scan"
+        };
+        ESP_ERROR_CHECK(esp_timer_create(&sargs, &g_scan_timer));
+    }
+    ESP_ERROR_CHECK(esp_event_handler_instance_register(
+        WIFI_EVENT, WIFI_EVENT_SCAN_DONE, &scan_event_handler, NULL, &g_scan_evt));
+
     softap_start();
     http_start();
 
+    // First scan right away, then periodic refresh
+    scan_kick();
+    esp_timer_start_periodic(g_scan_timer, (uint64_t)PROV_SCAN_REFRESH_MS * 1000ULL);
+
     // DNS wildcard server (captive portal)
-    xTaskCreate(dns_task, "prov_dns", 4096, NULL, 4, &g_dns_task);
+    xTaskCreate(dns_task, "prov_dns", PROV_DNS_TASK_STACK, NULL, 4, &g_dns_task);
 
     // Provisioning timeout
-    xTaskCreate(timeout_task, "prov_to", 2048, NULL, 3, &g_timeout_task);
+    xTaskCreate(timeout_task, "prov_to", PROV_TIMEOUT_TASK_STACK, NULL, 3, &g_timeout_task);
 
     ESP_LOGI(TAG, "Provisioning started (timeout=%d ms)", PROV_TIMEOUT_MS);
 }
 
-void provisioning_stop(void)
+// Tears the portal down. stop_radio=false keeps the driver (and STA link) up
+// and only removes the AP interface.
+static void portal_teardown(bool stop_radio)
 {
+    // Let the DNS task leave select() and close its socket before the netif goes away
+    g_stop = true;
+    for (int i = 0; i < 50 && (g_dns_task || g_timeout_task); i++)
+    {
+        vTaskDelay(pdMS_TO_TICKS(20));
+    }
+    if (g_dns_task) ESP_LOGW(TAG, "DNS task did not exit");
+
     if (g_http)
     {
         httpd_stop(g_http);
         g_http = NULL;
     }
 
-    // Stop Wi-Fi
-    esp_wifi_stop();
+    if (g_wifi_evt)
+    {
+        esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_STA_DISCONNECTED, g_wifi_evt);
+        g_wifi_evt = NULL;
+    }
+    if (g_ip_evt)
+    {
+        esp_event_handler_instance_unregister(IP_EVENT, IP_EVENT_STA_GOT_IP, g_ip_evt);
+        g_ip_evt = NULL;
+    }
+    if (g_test_timer) esp_timer_stop(g_test_timer);
+
+    if (g_scan_timer) esp_timer_stop(g_scan_timer);
+    if (g_scan_evt)
+    {
+        esp_event_handler_instance_unregister(WIFI_EVENT, WIFI_EVENT_SCAN_DONE, g_scan_evt);
+        g_scan_evt = NULL;
+    }
+    if (g_scan_busy)
+    {
+        esp_wifi_scan_stop();
+        g_scan_busy = false;
+    }
+
+    if (stop_radio)
+    {
+        esp_wifi_stop();
+    }
+    else
+    {
+        // Drop the AP interface only; STA association and IP stay as they are
+        esp_wifi_set_mode(WIFI_MODE_STA);
+    }
 
     // netif cleanup
     if (g_ap_netif)
@@ -424,8 +869,58 @@ void provisioning_stop(void)
         g_ap_netif = NULL;
     }
 
+    g_handoff = false;
+}
+
+void provisioning_stop(void)
+{
+    portal_teardown(true);
     ESP_LOGI(TAG, "Provisioning stopped");
 }
 
+void provisioning_begin_handoff(void)
+{
+    // The STA now belongs to wifi_manager: no more tests or portal scans
+    esp_timer_stop(g_scan_timer);
+    if (g_scan_busy)
+    {
+        esp_wifi_scan_stop();
+        g_scan_busy = false;
+    }
+    test_finish(TEST_FAIL, 0);
+
+    g_handoff_failed = false;
+    g_handoff = true;
+    ESP_LOGI(TAG, "Handoff: connecting STA with portal still up");
+}
+
+static void release_task(void *arg)
+{
+    (void)arg;
+    mem_monitor_task_enter(PROV_RELEASE_TASK_STACK);
+    vTaskDelay(pdMS_TO_TICKS(PROV_HANDOFF_LINGER_MS));
+    portal_teardown(false);
+    ESP_LOGI(TAG, "Handoff complete: AP released, STA kept");
+    mem_monitor_task_exit();
+    g_release_task = NULL;
+    vTaskDelete(NULL);
+}
+
+void provisioning_release_ap(void)
+{
+    if (g_release_task || !g_ap_netif) return;
+    xTaskCreate(release_task, "prov_rel", PROV_RELEASE_TASK_STACK, NULL, 3, &g_release_task);
+}
+
+void provisioning_resume(void)
+{
+    g_handoff = false;
+    g_handoff_failed = true;
+    g_done = false;
+    g_start_ms = now_ms();
+    esp_timer_start_periodic(g_scan_timer, (uint64_t)PROV_SCAN_REFRESH_MS * 1000ULL);
+    ESP_LOGW(TAG, "Handoff failed: portal reopened");
+}
+
 bool provisioning_is_done(void) { return g_done; }
 bool provisioning_has_failed(void) { return g_failed; }
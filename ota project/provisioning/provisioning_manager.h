@@ -6,6 +6,12 @@
 void provisioning_start(void);
 void provisioning_stop(void);
 
+// APSTA handoff: after /save the portal stays up while the STA connects
+// (wifi_manager_start reuses the running driver). /status shows the result.
+void provisioning_begin_handoff(void);  // STA attempt is about to start
+void provisioning_release_ap(void);     // STA is up: drop the AP after a linger, keep the driver
+void provisioning_resume(void);         // STA failed: reopen the portal for new creds
+
 bool provisioning_is_done(void);
 bool provisioning_has_failed(void);
 
@@ -0,0 +1,194 @@
+#include "fw_decrypt.h"
+#include "sha256_util.h"
+#include "config/ota_config.h"
+
+#include "mbedtls/aes.h"
+#include "mbedtls/platform_util.h"
+#include "nvs.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+
+static const char *TAG = "FW_DEC";
+
+// With CONFIG_MBEDTLS_HARDWARE_AES (the IDF default) mbedtls_aes_* runs
+// on the AES peripheral
+typedef struct {
+    mbedtls_aes_context aes;
+    uint8_t counter[16];
+    uint8_t stream[16];
+    size_t off;
+} ctr_state_t;
+
+static int hex_nibble(char ch)
+{
+    if (ch >= '0' && ch <= '9') return ch - '0';
+    ch = (char)tolower((unsigned char)ch);
+    if (ch >= 'a' && ch <= 'f') return ch - 'a' + 10;
+    return -1;
+}
+
+static bool hex_to_bytes(const char *hex, uint8_t *out, size_t n)
+{
+    if (!hex || strlen(hex) != n * 2) return false;
+    for (size_t i = 0; i < n; i++)
+    {
+        int hi = hex_nibble(hex[i*2]);
+        int lo = hex_nibble(hex[i*2 + 1]);
+        if (hi < 0 || lo < 0) return false;
+        out[i] = (uint8_t)((hi << 4) | lo);
+    }
+    return true;
+}
+
+// Keys are provisioned into NVS (factory partition image), never built in
+static bool load_key(const char *key_id, uint8_t *key, size_t key_len)
+{
+    const char *name = (key_id && key_id[0]) ? key_id : "fleet";
+    if (strcmp(name, "device") != 0 && strcmp(name, "fleet") != 0)
+    {
+        ESP_LOGE(TAG, "unknown key id '%s'", name);
+        return false;
+    }
+
+    nvs_handle_t h;
+    if (nvs_open(OTA_KEY_NVS_NS, NVS_READONLY, &h) != ESP_OK)
+    {
+        ESP_LOGE(TAG, "no key store");
+        return false;
+    }
+
+    size_t sz = key_len;
+    esp_err_t e = nvs_get_blob(h, name, key, &sz);
+    nvs_close(h);
+
+    if (e != ESP_OK || sz != key_len)
+    {
+        ESP_LOGE(TAG, "%s key missing or not %u bytes", name, (unsigned)key_len);
+        mbedtls_platform_zeroize(key, key_len);
+        return false;
+    }
+    return true;
+}
+
+bool fw_decrypt_init(fw_decrypt_ctx_t *c, const char *cipher, const char *key_id, const char *iv_hex)
+{
+    if (!c) return false;
+    c->ctx = NULL;
+
+    if (!cipher || !cipher[0] || strcmp(cipher, "none") == 0) return true;
+
+    size_t key_len;
+    if (strcmp(cipher, "aes-128-ctr") == 0) key_len = 16;
+    else if (strcmp(cipher, "aes-256-ctr") == 0) key_len = 32;
+    else
+    {
+        ESP_LOGE(TAG, "unsupported cipher '%s'", cipher);
+        return false;
+    }
+
+    ctr_state_t *s = calloc(1, sizeof(*s));
+    if (!s) return false;
+
+    if (!hex_to_bytes(iv_hex, s->counter, sizeof(s->counter)))
+    {
+        ESP_LOGE(TAG, "bad iv");
+        free(s);
+        return false;
+    }
+
+    uint8_t key[32];
+    if (!load_key(key_id, key, key_len))
+    {
+        free(s);
+        return false;
+    }
+
+    mbedtls_aes_init(&s->aes);
+    int rc = mbedtls_aes_setkey_enc(&s->aes, key, (unsigned)(key_len * 8));
+    mbedtls_platform_zeroize(key, sizeof(key));
+    if (rc != 0)
+    {
+        mbedtls_aes_free(&s->aes);
+        free(s);
+        return false;
+    }
+
+    c->ctx = s;
+    ESP_LOGI(TAG, "%s, %s key", cipher, (key_id && key_id[0]) ? key_id : "fleet");
+    return true;
+}
+
+bool fw_decrypt_enabled(const fw_decrypt_ctx_t *c)
+{
+    return c && c->ctx;
+}
+
+bool fw_decrypt_update(fw_decrypt_ctx_t *c, uint8_t *buf, size_t len)
+{
+    if (!c || !c->ctx || len == 0) return true;
+
+    // CTR keeps its position across calls, so chunk boundaries don't matter
+    ctr_state_t *s = (ctr_state_t*)c->ctx;
+    return mbedtls_aes_crypt_ctr(&s->aes, len, &s->off, s->counter, s->stream, buf, buf) == 0;
+}
+
+void fw_decrypt_free(fw_decrypt_ctx_t *c)
+{
+    if (!c || !c->ctx) return;
+    ctr_state_t *s = (ctr_state_t*)c->ctx;
+    mbedtls_aes_free(&s->aes);
+    mbedtls_platform_zeroize(s, sizeof(*s));
+    free(s);
+    c->ctx = NULL;
+}
+
+/* ---------- Benchmark ---------- */
+
+static uint32_t bench_pass(uint8_t *buf, size_t len, ctr_state_t *s)
+{
+    sha256_ctx_t sha;
+    uint8_t out[32];
+
+    int64_t t0 = esp_timer_get_time();
+    sha256_init(&sha);
+    for (size_t done = 0; done < OTA_DECRYPT_BENCH_BYTES; done += len)
+    {
+        if (s) mbedtls_aes_crypt_ctr(&s->aes, len, &s->off, s->counter, s->stream, buf, buf);
+        sha256_update(&sha, buf, len);
+    }
+    sha256_final(&sha, out);
+    sha256_free(&sha);
+    return (uint32_t)(esp_timer_get_time() - t0);
+}
+
+// Per-chunk CPU cost only; network and flash time are reported per update
+// in ota_update_timing_t
+void fw_decrypt_benchmark(uint8_t *buf, size_t len)
+{
+    if (!buf || len == 0) return;
+
+    ctr_state_t *s = calloc(1, sizeof(*s));
+    if (!s) return;
+
+    static const uint8_t key[16] = {0};
+    mbedtls_aes_init(&s->aes);
+    mbedtls_aes_setkey_enc(&s->aes, key, 128);
+    memset(buf, 0xA5, len);
+
+    uint32_t plain_us = bench_pass(buf, len, NULL);
+    uint32_t dec_us = bench_pass(buf, len, s);
+
+    mbedtls_aes_free(&s->aes);
+    free(s);
+
+    uint32_t kb = OTA_DECRYPT_BENCH_BYTES / 1024;
+    uint32_t chunks = (OTA_DECRYPT_BENCH_BYTES + len - 1) / len;
+    ESP_LOGI(TAG, "bench %lu KB in %u B chunks: sha256 %lu KB/s, aes-ctr+sha256 %lu KB/s (+%lu us/chunk)",
+             (unsigned long)kb, (unsigned)len,
+             (unsigned long)(plain_us ? (uint64_t)kb * 1000000 / plain_us : 0),
+             (unsigned long)(dec_us ? (uint64_t)kb * 1000000 / dec_us : 0),
+             (unsigned long)((dec_us > plain_us ? dec_us - plain_us : 0) / chunks));
+}
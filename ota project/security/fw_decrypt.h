@@ -0,0 +1,30 @@
+#ifndef FW_DECRYPT_H
+#define FW_DECRYPT_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+// Streaming decryption of firmware stored encrypted on the CDN.
+// AES-CTR keeps ciphertext the same size as the image and decrypts any
+// chunk length in place, so it slots in before hashing and writing.
+typedef struct {
+    void *ctx;   // opaque; NULL for a plain image
+} fw_decrypt_ctx_t;
+
+// cipher: "" / "none", "aes-128-ctr" or "aes-256-ctr" (from the manifest)
+// key_id: "device" or "fleet" (NULL / "" = fleet); key read from NVS
+// iv_hex: 32 hex chars, initial counter block
+bool fw_decrypt_init(fw_decrypt_ctx_t *c, const char *cipher, const char *key_id, const char *iv_hex);
+
+bool fw_decrypt_enabled(const fw_decrypt_ctx_t *c);
+
+// Decrypts len bytes in place; no-op for a plain image
+bool fw_decrypt_update(fw_decrypt_ctx_t *c, uint8_t *buf, size_t len);
+
+void fw_decrypt_free(fw_decrypt_ctx_t *c);
+
+// Logs SHA-256 vs AES-CTR + SHA-256 throughput over buf (clobbers it)
+void fw_decrypt_benchmark(uint8_t *buf, size_t len);
+
+#endif
@@ -1,7 +1,7 @@
 #include "sha256_util.h"
+#include "mbedtls/sha256.h"
 #include <string.h>
 #include <ctype.h>
-#include "sha256_util.h"
 #include <stdlib.h>
 
 
@@ -0,0 +1,175 @@
+#include "mem_monitor.h"
+#include "ota_diag.h"
+
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include <string.h>
+
+static const char *TAG = "MEM_MON";
+
+typedef struct {
+    mem_task_stat_t stat;
+    TaskHandle_t handle;        // NULL once the task has exited
+} task_slot_t;
+
+// Sampling a handle and a task clearing it on exit both hold g_lock, so
+// a deleted task is never sampled
+static SemaphoreHandle_t g_lock = NULL;
+static task_slot_t g_tasks[MEM_MON_MAX_TASKS];
+static int g_task_count = 0;
+
+static mem_snapshot_t g_snaps[MEM_MON_SNAPSHOTS];
+static int g_snap_head = 0;
+static int g_snap_count = 0;
+
+static void sample_slot(task_slot_t *s)
+{
+    if (!s->handle) return;
+    uint32_t free_b = (uint32_t)uxTaskGetStackHighWaterMark(s->handle);
+    if (free_b < s->stat.stack_free_min) s->stat.stack_free_min = free_b;
+}
+
+static task_slot_t *find_slot(const char *name)
+{
+    for (int i = 0; i < g_task_count; i++)
+    {
+        if (strcmp(g_tasks[i].stat.name, name) == 0) return &g_tasks[i];
+    }
+    if (g_task_count >= MEM_MON_MAX_TASKS) return NULL;
+
+    task_slot_t *s = &g_tasks[g_task_count++];
+    memset(s, 0, sizeof(*s));
+    strncpy(s->stat.name, name, sizeof(s->stat.name) - 1);
+    s->stat.stack_free_min = UINT32_MAX;
+    return s;
+}
+
+void mem_monitor_init(void)
+{
+    if (!g_lock) g_lock = xSemaphoreCreateMutex();
+}
+
+void mem_monitor_task_enter(uint32_t stack_size)
+{
+    if (!g_lock) return;
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    task_slot_t *s = find_slot(pcTaskGetName(self));
+    if (s)
+    {
+        s->handle = self;
+        s->stat.stack_size = stack_size;
+        s->stat.alive = true;
+    }
+    xSemaphoreGive(g_lock);
+}
+
+void mem_monitor_task_exit(void)
+{
+    if (!g_lock) return;
+
+    TaskHandle_t self = xTaskGetCurrentTaskHandle();
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    for (int i = 0; i < g_task_count; i++)
+    {
+        if (g_tasks[i].handle == self)
+        {
+            sample_slot(&g_tasks[i]);
+            g_tasks[i].handle = NULL;
+            g_tasks[i].stat.alive = false;
+        }
+    }
+    xSemaphoreGive(g_lock);
+}
+
+void mem_monitor_sample(const char *phase)
+{
+    if (!g_lock) return;
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    for (int i = 0; i < g_task_count; i++) sample_slot(&g_tasks[i]);
+
+    mem_snapshot_t *m = &g_snaps[g_snap_head];
+    m->time_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    m->phase = phase ? phase : "?";
+    m->heap_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    m->heap_free_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    m->heap_largest = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+
+    g_snap_head = (g_snap_head + 1) % MEM_MON_SNAPSHOTS;
+    if (g_snap_count < MEM_MON_SNAPSHOTS) g_snap_count++;
+    xSemaphoreGive(g_lock);
+}
+
+int mem_monitor_get_tasks(mem_task_stat_t *out, int max)
+{
+    if (!out || max <= 0 || !g_lock) return 0;
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    int n = (g_task_count < max) ? g_task_count : max;
+    for (int i = 0; i < n; i++) out[i] = g_tasks[i].stat;
+    xSemaphoreGive(g_lock);
+    return n;
+}
+
+int mem_monitor_get_snapshots(mem_snapshot_t *out, int max)
+{
+    if (!out || max <= 0 || !g_lock) return 0;
+
+    xSemaphoreTake(g_lock, portMAX_DELAY);
+    int n = (g_snap_count < max) ? g_snap_count : max;
+    int start = (g_snap_head - n + MEM_MON_SNAPSHOTS) % MEM_MON_SNAPSHOTS;
+    for (int i = 0; i < n; i++) out[i] = g_snaps[(start + i) % MEM_MON_SNAPSHOTS];
+    xSemaphoreGive(g_lock);
+    return n;
+}
+
+void mem_monitor_log(void)
+{
+    mem_task_stat_t t[MEM_MON_MAX_TASKS];
+    int nt = mem_monitor_get_tasks(t, MEM_MON_MAX_TASKS);
+    for (int i = 0; i < nt; i++)
+    {
+        if (t[i].stack_free_min == UINT32_MAX) continue;    // never sampled
+        ESP_LOGI(TAG, "task %-16s stack %5lu, min free %5lu%s", t[i].name,
+                 (unsigned long)t[i].stack_size, (unsigned long)t[i].stack_free_min,
+                 t[i].alive ? "" : " (exited)");
+    }
+
+    mem_snapshot_t s[MEM_MON_SNAPSHOTS];
+    int ns = mem_monitor_get_snapshots(s, MEM_MON_SNAPSHOTS);
+    for (int i = 0; i < ns; i++)
+    {
+        ESP_LOGI(TAG, "%8lu ms %-17s heap free %6lu, min %6lu, largest %6lu",
+                 (unsigned long)s[i].time_ms, s[i].phase, (unsigned long)s[i].heap_free,
+                 (unsigned long)s[i].heap_free_min, (unsigned long)s[i].heap_largest);
+    }
+}
+
+void mem_monitor_save(void)
+{
+    ota_diag_mem_t d;
+    memset(&d, 0, sizeof(d));
+
+    d.heap_free = (uint32_t)heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    d.heap_free_min = (uint32_t)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL);
+    d.heap_largest = (uint32_t)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL);
+
+    mem_task_stat_t t[MEM_MON_MAX_TASKS];
+    int nt = mem_monitor_get_tasks(t, MEM_MON_MAX_TASKS);
+    for (int i = 0; i < nt && d.task_count < OTA_DIAG_MEM_TASKS; i++)
+    {
+        if (t[i].stack_free_min == UINT32_MAX) continue;    // never sampled
+        ota_diag_task_mem_t *o = &d.tasks[d.task_count++];
+        strncpy(o->name, t[i].name, sizeof(o->name) - 1);
+        o->stack_size = t[i].stack_size;
+        o->stack_free_min = t[i].stack_free_min;
+    }
+
+    ota_diag_record_mem(&d);
+}
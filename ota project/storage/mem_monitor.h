@@ -0,0 +1,43 @@
+#ifndef MEM_MONITOR_H
+#define MEM_MONITOR_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define MEM_MON_MAX_TASKS   10
+#define MEM_MON_SNAPSHOTS   16
+
+// Per task name; kept after the task exits so repeated cycles accumulate
+typedef struct {
+    char name[16];
+    uint32_t stack_size;        // bytes, 0 = unknown
+    uint32_t stack_free_min;    // bytes, lowest high-water mark seen
+    bool alive;
+} mem_task_stat_t;
+
+// Internal heap at one phase boundary
+typedef struct {
+    uint32_t time_ms;
+    const char *phase;          // static string
+    uint32_t heap_free;
+    uint32_t heap_free_min;     // low-water mark since boot
+    uint32_t heap_largest;      // largest free block (fragmentation)
+} mem_snapshot_t;
+
+void mem_monitor_init(void);
+
+// Called by each project task on itself: first thing after it starts,
+// and right before vTaskDelete(NULL)
+void mem_monitor_task_enter(uint32_t stack_size);
+void mem_monitor_task_exit(void);
+
+// Sample all live tasks and the heap, tagged with a phase name
+void mem_monitor_sample(const char *phase);
+
+int mem_monitor_get_tasks(mem_task_stat_t *out, int max);
+int mem_monitor_get_snapshots(mem_snapshot_t *out, int max);   // oldest first
+
+void mem_monitor_log(void);
+void mem_monitor_save(void);    // summary into ota_diag (NVS)
+
+#endif
@@ -0,0 +1,29 @@
+#include "nvs_stats.h"
+
+#include "freertos/FreeRTOS.h"
+
+static portMUX_TYPE g_mux = portMUX_INITIALIZER_UNLOCKED;
+static uint32_t g_commits = 0;
+static uint32_t g_errors = 0;
+
+esp_err_t nvs_stats_commit(nvs_handle_t h)
+{
+    esp_err_t e = nvs_commit(h);
+
+    portENTER_CRITICAL(&g_mux);
+    g_commits++;
+    if (e != ESP_OK) g_errors++;
+    portEXIT_CRITICAL(&g_mux);
+
+    return e;
+}
+
+uint32_t nvs_stats_commits(void)
+{
+    return g_commits;
+}
+
+uint32_t nvs_stats_commit_errors(void)
+{
+    return g_errors;
+}
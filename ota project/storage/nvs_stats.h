@@ -0,0 +1,13 @@
+#ifndef NVS_STATS_H
+#define NVS_STATS_H
+
+#include <stdint.h>
+#include "nvs.h"
+
+// nvs_commit() that also counts, so flash write traffic shows up in metrics
+esp_err_t nvs_stats_commit(nvs_handle_t h);
+
+uint32_t nvs_stats_commits(void);
+uint32_t nvs_stats_commit_errors(void);
+
+#endif
@@ -1,4 +1,5 @@
 #include "ota_diag.h"
+#include "nvs_stats.h"
 
 #include "nvs_flash.h"
 #include "nvs.h"
@@ -19,6 +20,8 @@ static const char *TAG = "OTA_DIAG";
 #define KEY_LAST_INSTALLED_VER   "installed_ver"    // str
 #define KEY_ROLLBACK_SEEN        "rollback_seen"    // u8
 #define KEY_BOOT_COUNT           "boot_count"       // u32
+#define KEY_MEM                  "mem"              // blob: ota_diag_mem_t
+#define KEY_TLS                  "tls"              // blob: ota_diag_tls_t
 
 static bool nvs_open_ns(nvs_handle_t *out)
 {
@@ -39,12 +42,12 @@ bool ota_diag_init(void)
     return true;
 }
 
-static void nvs_set_u8(nvs_handle_t h, const char *key, uint8_t v)
+static void nvs_set_u8_safe(nvs_handle_t h, const char *key, uint8_t v)
 {
     (void)nvs_set_u8(h, key, v);
 }
 
-static void nvs_set_u32(nvs_handle_t h, const char *key, uint32_t v)
+static void nvs_set_u32_safe(nvs_handle_t h, const char *key, uint32_t v)
 {
     (void)nvs_set_u32(h, key, v);
 }
@@ -95,9 +98,9 @@ void ota_diag_record_attempt(const char *attempt_version)
     nvs_set_str_safe(h, KEY_LAST_ATTEMPT_VER, attempt_version);
 
     // Also clear rollback flag for a new attempt
-    nvs_set_u8(h, KEY_ROLLBACK_SEEN, 0);
+    nvs_set_u8_safe(h, KEY_ROLLBACK_SEEN, 0);
 
-    (void)nvs_commit(h);
+    (void)nvs_stats_commit(h);
     nvs_close(h);
 }
 
@@ -111,13 +114,13 @@ void ota_diag_record_result(ota_diag_status_t status,
     nvs_handle_t h;
     if (!nvs_open_ns(&h)) return;
 
-    nvs_set_u8(h, KEY_LAST_STATUS, (uint8_t)status);
-    nvs_set_u32(h, KEY_LAST_ERROR, (uint32_t)error_code);
+    nvs_set_u8_safe(h, KEY_LAST_STATUS, (uint8_t)status);
+    nvs_set_u32_safe(h, KEY_LAST_ERROR, (uint32_t)error_code);
 
     if (attempt_version) nvs_set_str_safe(h, KEY_LAST_ATTEMPT_VER, attempt_version);
     if (installed_version) nvs_set_str_safe(h, KEY_LAST_INSTALLED_VER, installed_version);
 
-    (void)nvs_commit(h);
+    (void)nvs_stats_commit(h);
     nvs_close(h);
 }
 
@@ -146,6 +149,75 @@ bool ota_diag_get_last(ota_diag_record_t *out)
     return true;
 }
 
+void ota_diag_record_mem(const ota_diag_mem_t *m)
+{
+    if (!m || !ota_diag_init()) return;
+
+    nvs_handle_t h;
+    if (!nvs_open_ns(&h)) return;
+
+    (void)nvs_set_blob(h, KEY_MEM, m, sizeof(*m));
+    (void)nvs_stats_commit(h);
+    nvs_close(h);
+}
+
+bool ota_diag_get_mem(ota_diag_mem_t *out)
+{
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+
+    if (!ota_diag_init()) return false;
+
+    nvs_handle_t h;
+    if (nvs_open(OTA_DIAG_NS, NVS_READONLY, &h) != ESP_OK) return false;
+
+    size_t sz = sizeof(*out);
+    esp_err_t e = nvs_get_blob(h, KEY_MEM, out, &sz);
+    nvs_close(h);
+
+    if (e != ESP_OK || sz != sizeof(*out))
+    {
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    if (out->task_count > OTA_DIAG_MEM_TASKS) out->task_count = OTA_DIAG_MEM_TASKS;
+    return true;
+}
+
+void ota_diag_record_tls(const ota_diag_tls_t *t)
+{
+    if (!t || !ota_diag_init()) return;
+
+    nvs_handle_t h;
+    if (!nvs_open_ns(&h)) return;
+
+    (void)nvs_set_blob(h, KEY_TLS, t, sizeof(*t));
+    (void)nvs_stats_commit(h);
+    nvs_close(h);
+}
+
+bool ota_diag_get_tls(ota_diag_tls_t *out)
+{
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+
+    if (!ota_diag_init()) return false;
+
+    nvs_handle_t h;
+    if (nvs_open(OTA_DIAG_NS, NVS_READONLY, &h) != ESP_OK) return false;
+
+    size_t sz = sizeof(*out);
+    esp_err_t e = nvs_get_blob(h, KEY_TLS, out, &sz);
+    nvs_close(h);
+
+    if (e != ESP_OK || sz != sizeof(*out))
+    {
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    return true;
+}
+
 static void increment_boot_count(void)
 {
     if (!ota_diag_init()) return;
@@ -155,9 +227,9 @@ static void increment_boot_count(void)
 
     uint32_t bc = nvs_get_u32_def(h, KEY_BOOT_COUNT, 0);
     bc++;
-    nvs_set_u32(h, KEY_BOOT_COUNT, bc);
+    nvs_set_u32_safe(h, KEY_BOOT_COUNT, bc);
 
-    (void)nvs_commit(h);
+    (void)nvs_stats_commit(h);
     nvs_close(h);
 }
 
@@ -177,10 +249,10 @@ void ota_diag_boot_check_and_update(void)
             nvs_handle_t h;
             if (nvs_open_ns(&h))
             {
-                nvs_set_u8(h, KEY_ROLLBACK_SEEN, 1);
-                nvs_set_u8(h, KEY_LAST_STATUS, (uint8_t)OTA_DIAG_STATUS_FAILED);
-                nvs_set_u32(h, KEY_LAST_ERROR, 0xFFFF); // rollback sentinel
-                (void)nvs_commit(h);
+                nvs_set_u8_safe(h, KEY_ROLLBACK_SEEN, 1);
+                nvs_set_u8_safe(h, KEY_LAST_STATUS, (uint8_t)OTA_DIAG_STATUS_FAILED);
+                nvs_set_u32_safe(h, KEY_LAST_ERROR, 0xFFFF); // rollback sentinel
+                (void)nvs_stats_commit(h);
                 nvs_close(h);
             }
         }
@@ -239,6 +311,11 @@ const char* ota_diag_error_short_str(uint16_t err)
         case 9:   return "OTA_WRITE";
         case 10:  return "OTA_END";
         case 11:  return "SET_BOOT";
+        case 13:  return "VERIFY";
+        case 14:  return "DECRYPT";
+        case 15:  return "BUSY";
+        case 16:  return "WAVE";
+        case 17:  return "NO_MEM";
         default:  return "ERR";
     }
 }
@@ -21,6 +21,32 @@ typedef struct {
     uint32_t boot_count;
 } ota_diag_record_t;
 
+// Memory summary of the last OTA session (see mem_monitor)
+#define OTA_DIAG_MEM_TASKS  10
+
+typedef struct {
+    char name[16];
+    uint32_t stack_size;
+    uint32_t stack_free_min;
+} ota_diag_task_mem_t;
+
+typedef struct {
+    uint32_t heap_free;
+    uint32_t heap_free_min;
+    uint32_t heap_largest;
+    uint8_t task_count;
+    ota_diag_task_mem_t tasks[OTA_DIAG_MEM_TASKS];
+} ota_diag_mem_t;
+
+// TLS handshakes this boot, at the end of the last OTA session (see tls_session)
+typedef struct {
+    uint32_t full;
+    uint32_t resumed;
+    uint32_t full_ms;
+    uint32_t resumed_ms;
+    uint32_t saved_ms;                  // estimate vs full handshakes
+} ota_diag_tls_t;
+
 // Call once at startup (safe to call multiple times)
 bool ota_diag_init(void);
 
@@ -37,6 +63,12 @@ void ota_diag_record_result(ota_diag_status_t status,
                             const char *attempt_version,
                             const char *installed_version);
 
+void ota_diag_record_mem(const ota_diag_mem_t *m);
+bool ota_diag_get_mem(ota_diag_mem_t *out);
+
+void ota_diag_record_tls(const ota_diag_tls_t *t);
+bool ota_diag_get_tls(ota_diag_tls_t *out);
+
 // Read last record
 bool ota_diag_get_last(ota_diag_record_t *out);
 
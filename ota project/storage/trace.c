@@ -0,0 +1,137 @@
+#include "trace.h"
+
+#include "esp_attr.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "esp_rom_sys.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#if !CONFIG_FREERTOS_UNICORE
+#include "esp_ipc.h"
+#endif
+#include <string.h>
+#include <stdio.h>
+
+#if TRACE_DUMP_AT_BOOT || TRACE_BENCH
+static const char *TAG = "trace";
+#endif
+
+_Static_assert((TRACE_RING_LEN & (TRACE_RING_LEN - 1)) == 0, "TRACE_RING_LEN must be a power of two");
+_Static_assert(sizeof(trace_rec_t) == 16, "trace record layout is read by tools/trace_decode.py");
+
+// Not zeroed at boot; validated by magic/version/length instead
+static RTC_NOINIT_ATTR trace_ring_t s_ring;
+
+// Claimed with an atomic add in DRAM (S32C1I doesn't work on RTC memory).
+// The two cores can finish their records out of order, so s_done keeps the
+// highest finished index with a CAS max; s_ring.head is its plain copy for
+// the next boot and the decoder.
+static uint32_t s_head = 0;
+static uint32_t s_done = 0;
+static int64_t s_last_sync_us = 0;
+
+void IRAM_ATTR trace_write(uint16_t id, uint32_t a, uint32_t b)
+{
+    uint32_t i = __atomic_fetch_add(&s_head, 1, __ATOMIC_RELAXED);
+    trace_rec_t *r = &s_ring.rec[i & (TRACE_RING_LEN - 1)];
+
+    r->cycles = esp_cpu_get_cycle_count();
+    r->id = id | (esp_cpu_get_core_id() ? TRACE_ID_CORE1 : 0);
+    r->a = a;
+    r->b = b;
+    __atomic_signal_fence(__ATOMIC_RELEASE);   // seq last: a torn record keeps the old one
+    r->seq = (uint16_t)i;
+
+    uint32_t h = __atomic_load_n(&s_done, __ATOMIC_RELAXED);
+    while ((int32_t)(i + 1 - h) > 0 &&
+           !__atomic_compare_exchange_n(&s_done, &h, i + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED))
+    {
+    }
+
+    // The other core may overwrite the copy with an older value; each writer
+    // repeats until its copy matches s_done, so the last one leaves the max
+    do
+    {
+        h = __atomic_load_n(&s_done, __ATOMIC_RELAXED);
+        s_ring.head = h;
+    } while (__atomic_load_n(&s_done, __ATOMIC_RELAXED) != h);
+}
+
+// Uptime against the calling core's CCOUNT
+static void sync_here(void *arg)
+{
+    (void)arg;
+    TRACE(TR_SYNC, esp_timer_get_time() / 1000, esp_rom_get_cpu_ticks_per_us());
+}
+
+static void emit_sync(void)
+{
+    s_last_sync_us = esp_timer_get_time();
+    sync_here(NULL);
+#if !CONFIG_FREERTOS_UNICORE
+    esp_ipc_call_blocking(!esp_cpu_get_core_id(), sync_here, NULL);
+#endif
+}
+
+#if TRACE_DUMP_AT_BOOT
+// Same bytes GET /trace returns, as "TRACE <offset> <hex>" lines
+static void dump(void)
+{
+    const uint8_t *p = (const uint8_t*)&s_ring;
+    char line[2 * 32 + 1];
+
+    ESP_LOGI(TAG, "previous ring: head %lu, boot %lu",
+             (unsigned long)s_ring.head, (unsigned long)s_ring.boot_seq);
+    for (size_t off = 0; off < sizeof(s_ring); off += 32)
+    {
+        size_t n = sizeof(s_ring) - off < 32 ? sizeof(s_ring) - off : 32;
+        for (size_t i = 0; i < n; i++) sprintf(&line[i * 2], "%02x", p[off + i]);
+        printf("TRACE %04x %s\n", (unsigned)off, line);
+    }
+}
+#endif
+
+void trace_init(void)
+{
+    if (s_ring.magic != TRACE_MAGIC || s_ring.version != TRACE_VERSION ||
+        s_ring.ring_len != TRACE_RING_LEN)
+    {
+        // Power-on (RTC memory is random) or a different layout
+        memset(&s_ring, 0, sizeof(s_ring));
+        s_ring.magic = TRACE_MAGIC;
+        s_ring.version = TRACE_VERSION;
+        s_ring.ring_len = TRACE_RING_LEN;
+        // Every slot's seq must mismatch its first index, or old zeros would decode
+        for (uint32_t i = 0; i < TRACE_RING_LEN; i++) s_ring.rec[i].seq = (uint16_t)(i - TRACE_RING_LEN);
+    }
+    else
+    {
+#if TRACE_DUMP_AT_BOOT
+        dump();
+#endif
+        s_ring.boot_seq++;
+    }
+
+    s_head = s_ring.head;
+    s_done = s_ring.head;
+    TRACE(TR_BOOT, esp_reset_reason(), s_ring.boot_seq);
+    emit_sync();
+
+#if TRACE_BENCH
+    uint32_t c0 = esp_cpu_get_cycle_count();
+    for (int i = 0; i < 100; i++) trace_write(TR_SYNC, 0, 0);
+    uint32_t c1 = esp_cpu_get_cycle_count();
+    ESP_LOGI(TAG, "%lu cycles per tracepoint", (unsigned long)((c1 - c0) / 100));
+    emit_sync();    // bench records carry no real sync
+#endif
+}
+
+void trace_tick(void)
+{
+    if (esp_timer_get_time() - s_last_sync_us >= 1000000) emit_sync();
+}
+
+const trace_ring_t *trace_ring(void)
+{
+    return &s_ring;
+}
@@ -0,0 +1,54 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "config/trace_config.h"
+
+// Binary tracepoints in an RTC slow memory ring that survives software
+// resets, panics and watchdogs (not power loss). A record is the CPU
+// cycle count, event id, core and two 32-bit args; no formatting.
+// Decode with tools/trace_decode.py (ring from GET /trace or a boot dump).
+
+#define TRACE_MAGIC    0x54524331u  // "TRC1"
+#define TRACE_VERSION  2
+
+#define TRACE_ID_CORE1 0x8000u      // set in rec.id when written on core 1
+
+typedef struct {
+    uint32_t cycles;        // CCOUNT of the writing core; that core's TR_SYNC anchors it
+    uint16_t id;            // trace_id_t | TRACE_ID_CORE1
+    uint16_t seq;           // low 16 bits of the write index, stored last
+    uint32_t a;
+    uint32_t b;
+} trace_rec_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t ring_len;
+    uint32_t head;          // next write index (monotonic across boots, never moves back)
+    uint32_t boot_seq;
+    trace_rec_t rec[TRACE_RING_LEN];
+} trace_ring_t;
+
+// Compile-time filtered: a disabled category leaves no code behind
+#define TRACE(id, a, b) \
+    do { \
+        if ((TRACE_ENABLE_MASK) & TRACE_CAT_BIT(id)) \
+            trace_write((uint16_t)(id), (uint32_t)(a), (uint32_t)(b)); \
+    } while (0)
+
+// Call first thing in app_main: keeps the previous boot's records
+void trace_init(void);
+
+void trace_write(uint16_t id, uint32_t a, uint32_t b);
+
+// Main loop: emits TR_SYNC on each core about once a second (CCOUNT wraps
+// in ~18 s at 240 MHz and the two cores' counters are not aligned)
+void trace_tick(void);
+
+// Raw ring for export (records may be mid-write; the decoder checks seq)
+const trace_ring_t *trace_ring(void);
+
+#endif
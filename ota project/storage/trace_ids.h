@@ -0,0 +1,40 @@
+#ifndef TRACE_IDS_H
+#define TRACE_IDS_H
+
+// Tracepoint categories (bit per category, see TRACE_ENABLE_MASK)
+#define TRACE_CAT_SYS     (1u << 0)
+#define TRACE_CAT_SM      (1u << 1)
+#define TRACE_CAT_WIFI    (1u << 2)
+#define TRACE_CAT_HTTP    (1u << 3)
+#define TRACE_CAT_FLASH   (1u << 4)
+
+// X(name, id, arg a, arg b): high byte of the id is the category index.
+// tools/trace_decode.py reads this list, so keep one entry per line.
+#define TRACE_EVENTS(X) \
+    X(TR_BOOT,         0x0001, "reset_reason", "boot_seq") \
+    X(TR_SYNC,         0x0002, "uptime_ms",    "ticks_per_us") \
+    X(TR_RESTART,      0x0003, "error",        "bytes") \
+    X(TR_OTA_RESULT,   0x0004, "error",        "bytes") \
+    X(TR_STATE,        0x0101, "from",         "to") \
+    X(TR_WIFI_EVENT,   0x0201, "event_id",     "reason") \
+    X(TR_WIFI_GOT_IP,  0x0202, "connect_ms",   "fast") \
+    X(TR_HTTP_OPEN,    0x0301, "status",       "ms") \
+    X(TR_HTTP_READ,    0x0302, "bytes",        "us") \
+    X(TR_HTTP_DONE,    0x0303, "bytes",        "error") \
+    X(TR_MIRROR_RTT,   0x0304, "mirror",       "ms") \
+    X(TR_FAILOVER,     0x0305, "offset",       "mirror") \
+    X(TR_TLS_OPEN,     0x0306, "resumed",      "ms") \
+    X(TR_OTA_BEGIN,    0x0401, "ms",           "sequential") \
+    X(TR_OTA_WRITE,    0x0402, "offset",       "us") \
+    X(TR_SHA,          0x0403, "bytes",        "us") \
+    X(TR_DECRYPT,      0x0404, "bytes",        "us")
+
+#define TRACE_ENUM_(name, id, a, b) name = id,
+typedef enum {
+    TRACE_EVENTS(TRACE_ENUM_)
+} trace_id_t;
+#undef TRACE_ENUM_
+
+#define TRACE_CAT_BIT(id)  (1u << ((unsigned)(id) >> 8))
+
+#endif
@@ -1,11 +1,32 @@
 #include "wifi_nvs.h"
+#include "nvs_stats.h"
 #include "nvs.h"
 #include "nvs_flash.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include <string.h>
 
 #define WIFI_NVS_NS     "wifi_creds"
-#define WIFI_NVS_KEY_S  "ssid"
+#define WIFI_NVS_KEY_S  "ssid"      // legacy single-network keys (imported on read)
 #define WIFI_NVS_KEY_P  "pass"
+#define WIFI_NVS_KEY_N  "nets"      // blob: nets_blob_t header + count entries
+#define WIFI_NVS_KEY_F  "fast"      // blob: wifi_nvs_fast_t
+
+#define NETS_VERSION    1
+
+typedef struct {
+    uint8_t version;
+    uint8_t count;
+    uint16_t reserved;
+    uint32_t seq;                   // logical clock handed out as last_success
+    wifi_nvs_net_t nets[WIFI_NVS_MAX_NETS];
+} nets_blob_t;
+
+#define NETS_HDR_SZ     offsetof(nets_blob_t, nets)
+
+// Shared scratch blob: callers are the event task, httpd and app_main
+static nets_blob_t nets_buf;
+static SemaphoreHandle_t nets_lock = NULL;
 
 static bool nvs_ready(void)
 {
@@ -15,23 +36,175 @@ static bool nvs_ready(void)
         nvs_flash_erase();
         ret = nvs_flash_init();
     }
-    return ret == ESP_OK;
+    if (ret == ESP_OK && !nets_lock) nets_lock = xSemaphoreCreateMutex();
+    return ret == ESP_OK && nets_lock != NULL;
 }
 
-bool wifi_nvs_save_creds(const char *ssid, const char *pass)
+/* ---------- Blob I/O (call with nets_lock held) ---------- */
+
+static bool nets_read(nvs_handle_t h, nets_blob_t *b)
 {
-    if (!ssid || !pass) return false;
-    if (!nvs_ready()) return false;
+    memset(b, 0, sizeof(*b));
+
+    size_t sz = sizeof(*b);
+    if (nvs_get_blob(h, WIFI_NVS_KEY_N, b, &sz) != ESP_OK ||
+        sz < NETS_HDR_SZ || b->version != NETS_VERSION)
+    {
+        memset(b, 0, sizeof(*b));
+        return false;
+    }
+
+    size_t stored = (sz - NETS_HDR_SZ) / sizeof(wifi_nvs_net_t);
+    if (b->count > stored) b->count = (uint8_t)stored;
+    if (b->count > WIFI_NVS_MAX_NETS) b->count = WIFI_NVS_MAX_NETS;
+    for (int i = 0; i < b->count; i++)
+    {
+        b->nets[i].ssid[sizeof(b->nets[i].ssid) - 1] = '\0';
+        b->nets[i].pass[sizeof(b->nets[i].pass) - 1] = '\0';
+    }
+    return true;
+}
+
+// Import the pre-blob single SSID/password pair, if present
+static void nets_import_legacy(nvs_handle_t h, nets_blob_t *b)
+{
+    wifi_nvs_net_t *n = &b->nets[0];
+    size_t ssz = sizeof(n->ssid);
+    size_t psz = sizeof(n->pass);
+
+    if (nvs_get_str(h, WIFI_NVS_KEY_S, n->ssid, &ssz) == ESP_OK &&
+        nvs_get_str(h, WIFI_NVS_KEY_P, n->pass, &psz) == ESP_OK &&
+        n->ssid[0] != '\0')
+    {
+        b->version = NETS_VERSION;
+        b->count = 1;
+    }
+    else
+    {
+        memset(n, 0, sizeof(*n));
+    }
+}
+
+static void nets_load(nets_blob_t *b)
+{
+    memset(b, 0, sizeof(*b));
+
+    nvs_handle_t h;
+    if (nvs_open(WIFI_NVS_NS, NVS_READONLY, &h) != ESP_OK) return;
+    if (!nets_read(h, b)) nets_import_legacy(h, b);
+    nvs_close(h);
+}
 
+static bool nets_store(const nets_blob_t *b)
+{
     nvs_handle_t h;
     if (nvs_open(WIFI_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return false;
 
-    esp_err_t e1 = nvs_set_str(h, WIFI_NVS_KEY_S, ssid);
-    esp_err_t e2 = nvs_set_str(h, WIFI_NVS_KEY_P, pass);
-    esp_err_t ec = nvs_commit(h);
+    size_t sz = NETS_HDR_SZ + (size_t)b->count * sizeof(wifi_nvs_net_t);
+    esp_err_t e = nvs_set_blob(h, WIFI_NVS_KEY_N, b, sz);
+
+    // Legacy keys are superseded once the blob exists
+    (void)nvs_erase_key(h, WIFI_NVS_KEY_S);
+    (void)nvs_erase_key(h, WIFI_NVS_KEY_P);
 
+    esp_err_t c = nvs_stats_commit(h);
     nvs_close(h);
-    return (e1 == ESP_OK && e2 == ESP_OK && ec == ESP_OK);
+    return (e == ESP_OK && c == ESP_OK);
+}
+
+static int nets_find(const nets_blob_t *b, const char *ssid)
+{
+    for (int i = 0; i < b->count; i++)
+    {
+        if (strcmp(b->nets[i].ssid, ssid) == 0) return i;
+    }
+    return -1;
+}
+
+/* ---------- Public API ---------- */
+
+bool wifi_nvs_add_net(const char *ssid, const char *pass)
+{
+    if (!ssid || !pass || ssid[0] == '\0') return false;
+    if (!nvs_ready()) return false;
+
+    xSemaphoreTake(nets_lock, portMAX_DELAY);
+    nets_blob_t *b = &nets_buf;
+    nets_load(b);
+    b->version = NETS_VERSION;
+
+    int idx = nets_find(b, ssid);
+    if (idx < 0)
+    {
+        if (b->count < WIFI_NVS_MAX_NETS)
+        {
+            idx = b->count++;
+        }
+        else
+        {
+            // Full: evict the network that has gone longest without a success
+            idx = 0;
+            for (int i = 1; i < b->count; i++)
+            {
+                if (b->nets[i].last_success < b->nets[idx].last_success) idx = i;
+            }
+        }
+        memset(&b->nets[idx], 0, sizeof(b->nets[idx]));
+        strncpy(b->nets[idx].ssid, ssid, sizeof(b->nets[idx].ssid) - 1);
+    }
+
+    // New or changed password: history no longer applies
+    if (strcmp(b->nets[idx].pass, pass) != 0)
+    {
+        memset(b->nets[idx].pass, 0, sizeof(b->nets[idx].pass));
+        strncpy(b->nets[idx].pass, pass, sizeof(b->nets[idx].pass) - 1);
+        b->nets[idx].success_count = 0;
+    }
+
+    bool ok = nets_store(b);
+    xSemaphoreGive(nets_lock);
+    return ok;
+}
+
+bool wifi_nvs_mark_success(const char *ssid)
+{
+    if (!ssid) return false;
+    if (!nvs_ready()) return false;
+
+    xSemaphoreTake(nets_lock, portMAX_DELAY);
+    nets_blob_t *b = &nets_buf;
+    nets_load(b);
+
+    bool ok = false;
+    int idx = nets_find(b, ssid);
+    if (idx >= 0 && b->nets[idx].last_success == b->seq &&
+        b->nets[idx].success_count >= WIFI_NVS_SUCCESS_CAP)
+    {
+        ok = true;      // every reconnect to the same AP lands here
+    }
+    else if (idx >= 0)
+    {
+        b->version = NETS_VERSION;
+        b->nets[idx].last_success = ++b->seq;
+        if (b->nets[idx].success_count < WIFI_NVS_SUCCESS_CAP) b->nets[idx].success_count++;
+        ok = nets_store(b);
+    }
+
+    xSemaphoreGive(nets_lock);
+    return ok;
+}
+
+int wifi_nvs_load_nets(wifi_nvs_net_t *out, int max)
+{
+    if (!out || max <= 0) return 0;
+    if (!nvs_ready()) return 0;
+
+    xSemaphoreTake(nets_lock, portMAX_DELAY);
+    nets_load(&nets_buf);
+    int n = (nets_buf.count < max) ? nets_buf.count : max;
+    memcpy(out, nets_buf.nets, (size_t)n * sizeof(wifi_nvs_net_t));
+    xSemaphoreGive(nets_lock);
+    return n;
 }
 
 bool wifi_nvs_load_creds(char *ssid_out, size_t ssid_sz, char *pass_out, size_t pass_sz)
@@ -40,19 +213,22 @@ bool wifi_nvs_load_creds(char *ssid_out, size_t ssid_sz, char *pass_out, size_t
     ssid_out[0] = '\0';
     pass_out[0] = '\0';
 
-    if (!nvs_ready()) return false;
-
-    nvs_handle_t h;
-    if (nvs_open(WIFI_NVS_NS, NVS_READONLY, &h) != ESP_OK) return false;
-
-    size_t ssz = ssid_sz;
-    size_t psz = pass_sz;
+    wifi_nvs_net_t nets[WIFI_NVS_MAX_NETS];
+    int n = wifi_nvs_load_nets(nets, WIFI_NVS_MAX_NETS);
+    if (n == 0) return false;
 
-    esp_err_t e1 = nvs_get_str(h, WIFI_NVS_KEY_S, ssid_out, &ssz);
-    esp_err_t e2 = nvs_get_str(h, WIFI_NVS_KEY_P, pass_out, &psz);
+    // Most recently successful network (or the first one stored)
+    int best = 0;
+    for (int i = 1; i < n; i++)
+    {
+        if (nets[i].last_success > nets[best].last_success) best = i;
+    }
 
-    nvs_close(h);
-    return (e1 == ESP_OK && e2 == ESP_OK && ssid_out[0] != '\0');
+    strncpy(ssid_out, nets[best].ssid, ssid_sz - 1);
+    ssid_out[ssid_sz - 1] = '\0';
+    strncpy(pass_out, nets[best].pass, pass_sz - 1);
+    pass_out[pass_sz - 1] = '\0';
+    return ssid_out[0] != '\0';
 }
 
 bool wifi_nvs_has_creds(void)
@@ -69,8 +245,46 @@ bool wifi_nvs_clear(void)
     if (nvs_open(WIFI_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return false;
 
     esp_err_t e = nvs_erase_all(h);
-    esp_err_t c = nvs_commit(h);
+    esp_err_t c = nvs_stats_commit(h);
     nvs_close(h);
 
     return (e == ESP_OK && c == ESP_OK);
 }
+
+bool wifi_nvs_save_fast(const wifi_nvs_fast_t *f)
+{
+    if (!f) return false;
+    if (!nvs_ready()) return false;
+
+    nvs_handle_t h;
+    if (nvs_open(WIFI_NVS_NS, NVS_READWRITE, &h) != ESP_OK) return false;
+
+    esp_err_t e = nvs_set_blob(h, WIFI_NVS_KEY_F, f, sizeof(*f));
+    esp_err_t c = nvs_stats_commit(h);
+    nvs_close(h);
+
+    return (e == ESP_OK && c == ESP_OK);
+}
+
+bool wifi_nvs_load_fast(wifi_nvs_fast_t *out)
+{
+    if (!out) return false;
+    memset(out, 0, sizeof(*out));
+
+    if (!nvs_ready()) return false;
+
+    nvs_handle_t h;
+    if (nvs_open(WIFI_NVS_NS, NVS_READONLY, &h) != ESP_OK) return false;
+
+    size_t sz = sizeof(*out);
+    esp_err_t e = nvs_get_blob(h, WIFI_NVS_KEY_F, out, &sz);
+    nvs_close(h);
+
+    if (e != ESP_OK || sz != sizeof(*out))
+    {
+        memset(out, 0, sizeof(*out));
+        return false;
+    }
+    out->ssid[sizeof(out->ssid) - 1] = '\0';
+    return out->ssid[0] != '\0' && out->channel != 0;
+}
@@ -3,10 +3,48 @@
 
 #include <stdbool.h>
 #include <stddef.h>
+#include <stdint.h>
 
-bool wifi_nvs_save_creds(const char *ssid, const char *pass);
+#define WIFI_NVS_MAX_NETS   5
+
+// One known network. last_success is a store-wide logical timestamp
+// (higher = more recent, 0 = never), so no wall clock is needed.
+// Ranking stops weighing history past this many successes
+#define WIFI_NVS_SUCCESS_CAP  10
+
+typedef struct {
+    char ssid[32];
+    char pass[64];
+    uint32_t last_success;
+    uint16_t success_count;         // saturates at WIFI_NVS_SUCCESS_CAP
+    uint16_t reserved;
+} wifi_nvs_net_t;
+
+// Last successful association, used for fast reconnect
+typedef struct {
+    char ssid[32];
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint32_t ip;            // lease, network byte order (0 = none)
+    uint32_t gw;
+    uint32_t netmask;
+    uint32_t dns;
+} wifi_nvs_fast_t;
+
+// Add a network, or update its password if already known.
+// When full, the network with the oldest success is evicted.
+bool wifi_nvs_add_net(const char *ssid, const char *pass);
+// Bumps the network's recency and count; no flash write when neither
+// can change the ranking (already newest, count saturated)
+bool wifi_nvs_mark_success(const char *ssid);
+int wifi_nvs_load_nets(wifi_nvs_net_t *out, int max);    // returns count
+
+// Most recently successful network
 bool wifi_nvs_load_creds(char *ssid_out, size_t ssid_sz, char *pass_out, size_t pass_sz);
 bool wifi_nvs_has_creds(void);
 bool wifi_nvs_clear(void);
 
+bool wifi_nvs_save_fast(const wifi_nvs_fast_t *f);
+bool wifi_nvs_load_fast(wifi_nvs_fast_t *out);
+
 #endif
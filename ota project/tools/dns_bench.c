@@ -0,0 +1,235 @@
+/*
+ * Host-side load benchmark for the captive-portal DNS responder.
+ *
+ * Build (from the project directory):
+ *     gcc -O2 -I. tools/dns_bench.c provisioning/dns_responder.c -o dns_bench
+ *
+ * Modes:
+ *     ./dns_bench                       in-process: responder + rate limiter, queries/sec
+ *     ./dns_bench 192.168.4.1 [secs]    over UDP against a device running the portal
+ *
+ * The query mix covers A, AAAA, HTTPS and an EDNS-padded A query, the
+ * types phones send while probing a captive network.
+ */
+
+#include "provisioning/dns_responder.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/select.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#define IN_PROCESS_ITERS    5000000
+#define UDP_WINDOW          32      // outstanding queries per socket
+#define UDP_SOCKETS         4       // distinct source ports (rate limiter is per IP, not port)
+
+typedef struct {
+    const char *name;
+    uint8_t pkt[64];
+    int len;
+    uint16_t expect_an;
+} query_t;
+
+static query_t s_queries[4];
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int build_query(uint8_t *p, uint16_t id, const char *host, uint16_t qtype, int edns)
+{
+    int o = 0;
+    p[o++] = id >> 8; p[o++] = id & 0xFF;
+    p[o++] = 0x01; p[o++] = 0x00;               // RD
+    p[o++] = 0; p[o++] = 1;                     // QDCOUNT
+    p[o++] = 0; p[o++] = 0;
+    p[o++] = 0; p[o++] = 0;
+    p[o++] = 0; p[o++] = edns ? 1 : 0;          // ARCOUNT
+
+    const char *s = host;
+    while (*s)
+    {
+        const char *dot = strchr(s, '.');
+        int n = dot ? (int)(dot - s) : (int)strlen(s);
+        p[o++] = (uint8_t)n;
+        memcpy(&p[o], s, (size_t)n);
+        o += n;
+        s += n;
+        if (*s == '.') s++;
+    }
+    p[o++] = 0;
+    p[o++] = qtype >> 8; p[o++] = qtype & 0xFF;
+    p[o++] = 0; p[o++] = 1;                     // IN
+
+    if (edns)
+    {
+        static const uint8_t opt[] = { 0, 0, 41, 0x10, 0, 0, 0, 0, 0, 0, 0 };
+        memcpy(&p[o], opt, sizeof(opt));
+        o += (int)sizeof(opt);
+    }
+    return o;
+}
+
+static void init_queries(void)
+{
+    s_queries[0].name = "A";
+    s_queries[0].len = build_query(s_queries[0].pkt, 1, "connectivitycheck.gstatic.com", 1, 0);
+    s_queries[0].expect_an = 1;
+    s_queries[1].name = "AAAA";
+    s_queries[1].len = build_query(s_queries[1].pkt, 2, "captive.apple.com", 28, 0);
+    s_queries[1].expect_an = 0;
+    s_queries[2].name = "HTTPS";
+    s_queries[2].len = build_query(s_queries[2].pkt, 3, "www.msftconnecttest.com", 65, 0);
+    s_queries[2].expect_an = 0;
+    s_queries[3].name = "A+EDNS";
+    s_queries[3].len = build_query(s_queries[3].pkt, 4, "detectportal.firefox.com", 1, 1);
+    s_queries[3].expect_an = 1;
+}
+
+static int check_response(const uint8_t *r, int n, const query_t *q)
+{
+    if (n < 12) return 0;
+    if (r[0] != q->pkt[0] || r[1] != q->pkt[1]) return 0;
+    if (!(r[2] & 0x80)) return 0;
+    if ((r[3] & 0x0F) != 0) return 0;
+    return ((r[6] << 8) | r[7]) == q->expect_an;
+}
+
+static int bench_in_process(void)
+{
+    uint8_t buf[DNS_MAX_PACKET];
+    int bad = 0;
+
+    dns_responder_init(inet_addr("192.168.4.1"), 60);
+
+    // Correctness first
+    for (int i = 0; i < 4; i++)
+    {
+        memcpy(buf, s_queries[i].pkt, (size_t)s_queries[i].len);
+        int n = dns_responder_answer(buf, s_queries[i].len, sizeof(buf));
+        int ok = check_response(buf, n, &s_queries[i]);
+        printf("  %-7s -> %3d bytes, %s\n", s_queries[i].name, n, ok ? "ok" : "BAD");
+        if (!ok) bad++;
+    }
+
+    double t0 = now_s();
+    long sink = 0;
+    for (long i = 0; i < IN_PROCESS_ITERS; i++)
+    {
+        const query_t *q = &s_queries[i & 3];
+        memcpy(buf, q->pkt, (size_t)q->len);
+        sink += dns_responder_answer(buf, q->len, sizeof(buf));
+    }
+    double dt = now_s() - t0;
+    printf("responder:    %.2f M queries/s (%.0f ns/query, sink=%ld)\n",
+           IN_PROCESS_ITERS / dt / 1e6, dt * 1e9 / IN_PROCESS_ITERS, sink);
+
+    // Rate limiter: 8 clients, 1 ms apart -> mostly throttled after the burst
+    long allowed = 0;
+    t0 = now_s();
+    for (long i = 0; i < IN_PROCESS_ITERS; i++)
+    {
+        allowed += dns_rate_allow((uint32_t)(i & 7), i / 8);
+    }
+    dt = now_s() - t0;
+    printf("rate limiter: %.2f M checks/s (%ld/%d allowed)\n",
+           IN_PROCESS_ITERS / dt / 1e6, allowed, IN_PROCESS_ITERS);
+
+    return bad ? 1 : 0;
+}
+
+static int bench_udp(const char *ip, int secs)
+{
+    struct sockaddr_in dst = {0};
+    dst.sin_family = AF_INET;
+    dst.sin_port = htons(53);
+    if (inet_pton(AF_INET, ip, &dst.sin_addr) != 1)
+    {
+        fprintf(stderr, "bad address: %s\n", ip);
+        return 1;
+    }
+
+    int socks[UDP_SOCKETS];
+    int maxfd = 0;
+    for (int i = 0; i < UDP_SOCKETS; i++)
+    {
+        socks[i] = socket(AF_INET, SOCK_DGRAM, 0);
+        if (socks[i] < 0) { perror("socket"); return 1; }
+        fcntl(socks[i], F_SETFL, O_NONBLOCK);
+        if (socks[i] > maxfd) maxfd = socks[i];
+    }
+
+    long sent = 0, recvd = 0, bad = 0;
+    int outstanding[UDP_SOCKETS] = {0};
+    double start = now_s(), end = start + secs, last_send = start;
+
+    while (now_s() < end)
+    {
+        for (int i = 0; i < UDP_SOCKETS; i++)
+        {
+            while (outstanding[i] < UDP_WINDOW)
+            {
+                const query_t *q = &s_queries[sent & 3];
+                if (sendto(socks[i], q->pkt, (size_t)q->len, 0, (struct sockaddr*)&dst, sizeof(dst)) < 0) break;
+                outstanding[i]++;
+                sent++;
+                last_send = now_s();
+            }
+        }
+
+        fd_set rfds;
+        FD_ZERO(&rfds);
+        for (int i = 0; i < UDP_SOCKETS; i++) FD_SET(socks[i], &rfds);
+        struct timeval tv = { 0, 50000 };
+        if (select(maxfd + 1, &rfds, NULL, NULL, &tv) <= 0)
+        {
+            // Dropped (rate limited or lost): release the window after a quiet period
+            if (now_s() - last_send > 0.2)
+                for (int i = 0; i < UDP_SOCKETS; i++) outstanding[i] = 0;
+            continue;
+        }
+
+        for (int i = 0; i < UDP_SOCKETS; i++)
+        {
+            uint8_t r[DNS_MAX_PACKET];
+            int n;
+            while ((n = (int)recv(socks[i], r, sizeof(r), 0)) > 0)
+            {
+                if (outstanding[i] > 0) outstanding[i]--;
+                recvd++;
+                const query_t *q = NULL;
+                for (int k = 0; k < 4; k++) if (r[1] == s_queries[k].pkt[1]) q = &s_queries[k];
+                if (!q || !check_response(r, n, q)) bad++;
+            }
+        }
+    }
+
+    double dt = now_s() - start;
+    printf("udp %s: sent=%ld answered=%ld (%.1f%%) bad=%ld  %.0f answers/s\n",
+           ip, sent, recvd, sent ? 100.0 * recvd / sent : 0.0, bad, recvd / dt);
+
+    for (int i = 0; i < UDP_SOCKETS; i++) close(socks[i]);
+    return bad ? 1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    init_queries();
+
+    if (argc > 1)
+    {
+        int secs = (argc > 2) ? atoi(argv[2]) : 10;
+        return bench_udp(argv[1], secs > 0 ? secs : 10);
+    }
+    return bench_in_process();
+}
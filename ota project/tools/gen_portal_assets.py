@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""Embed the captive-portal assets as gzip-precompressed C arrays.
+
+Reads provisioning/portal/* and writes provisioning/portal_assets.c.
+Re-run after editing any portal asset:
+
+    python3 tools/gen_portal_assets.py
+
+Output is deterministic (gzip mtime=0), so unchanged assets produce an
+identical file and an identical ETag.
+"""
+
+import gzip
+import hashlib
+import os
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+SRC_DIR = os.path.join(ROOT, "provisioning", "portal")
+OUT_C = os.path.join(ROOT, "provisioning", "portal_assets.c")
+
+# (file, uri, content type, cache-control)
+ASSETS = [
+    ("index.html", "/",           "text/html",              "no-cache"),
+    ("saved.html", "/saved.html", "text/html",              "no-cache"),
+    ("portal.css", "/portal.css", "text/css",               "public, max-age=86400"),
+    ("portal.js",  "/portal.js",  "application/javascript", "public, max-age=86400"),
+]
+
+
+def c_ident(name):
+    return "asset_" + "".join(c if c.isalnum() else "_" for c in name)
+
+
+def main():
+    out = []
+    out.append("// Generated by tools/gen_portal_assets.py - do not edit.")
+    out.append("// Sources: provisioning/portal/")
+    out.append("")
+    out.append('#include "portal_assets.h"')
+    out.append("")
+
+    entries = []
+    for fname, uri, ctype, cache in ASSETS:
+        with open(os.path.join(SRC_DIR, fname), "rb") as f:
+            raw = f.read()
+        gz = gzip.compress(raw, compresslevel=9, mtime=0)
+        etag = '"%s"' % hashlib.sha256(gz).hexdigest()[:16]
+        ident = c_ident(fname)
+
+        out.append("// %s: %d -> %d bytes" % (fname, len(raw), len(gz)))
+        out.append("static const uint8_t %s[%d] = {" % (ident, len(gz)))
+        for i in range(0, len(gz), 16):
+            out.append("    " + ", ".join("0x%02x" % b for b in gz[i:i + 16]) + ",")
+        out.append("};")
+        out.append("")
+        entries.append((uri, ctype, ident, len(gz), etag, cache))
+
+    out.append("const portal_asset_t PORTAL_ASSETS[] = {")
+    for uri, ctype, ident, n, etag, cache in entries:
+        out.append('    { "%s", "%s", %s, %d, "%s", "%s" },'
+                   % (uri, ctype, ident, n, etag.replace('"', '\\"'), cache))
+    out.append("};")
+    out.append("")
+    out.append("const size_t PORTAL_ASSET_COUNT = sizeof(PORTAL_ASSETS) / sizeof(PORTAL_ASSETS[0]);")
+    out.append("")
+
+    with open(OUT_C, "w", newline="\n") as f:
+        f.write("\n".join(out))
+    print("wrote %s (%d assets)" % (os.path.relpath(OUT_C, ROOT), len(entries)))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
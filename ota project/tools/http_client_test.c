@@ -0,0 +1,295 @@
+/*
+ * Host-side tests for the HTTP/1.1 client under tls_session.c.
+ *
+ * Build and run (from the project directory):
+ *     gcc -O2 -Wall -I. tools/http_client_test.c network/http_client.c -o http_client_test
+ *     ./http_client_test
+ *
+ * Each canned response is fed through a fake transport several times, in
+ * reads of 1, 7 and 4096 bytes, so head/body and chunk boundaries land
+ * everywhere. Prints every failed check; exits non-zero if there was one.
+ */
+
+#include "network/http_client.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct {
+    const char *data;
+    size_t len, pos;
+    size_t step;                // largest read handed back
+    char sent[OTA_HTTP_TX_BUF_SIZE + 1];
+} fake_t;
+
+static int fake_recv(void *ctx, void *buf, size_t len)
+{
+    fake_t *f = (fake_t*)ctx;
+    size_t n = f->len - f->pos;
+    if (n > len) n = len;
+    if (n > f->step) n = f->step;
+    memcpy(buf, f->data + f->pos, n);
+    f->pos += n;
+    return (int)n;              // 0 once drained: the server closed
+}
+
+static int fake_send(void *ctx, const void *buf, size_t len)
+{
+    fake_t *f = (fake_t*)ctx;
+    if (len > sizeof(f->sent) - 1) return -1;
+    memcpy(f->sent, buf, len);
+    f->sent[len] = '\0';
+    return 0;
+}
+
+static int s_failed = 0;
+static int s_passed = 0;
+
+#define CHECK(cond, ...) do { \
+        if (cond) { s_passed++; break; } \
+        s_failed++; \
+        printf("FAIL %s:%d: ", __FILE__, __LINE__); \
+        printf(__VA_ARGS__); \
+        printf("\n"); \
+    } while (0)
+
+static const size_t k_steps[] = { 1, 7, 4096 };
+
+// Reads the whole body; returns the last http_read_body() result (0 = clean end)
+static int drain(http_stream_t *h, char *out, size_t cap, size_t *got)
+{
+    *got = 0;
+    for (;;)
+    {
+        char buf[5];            // small reads cross chunk boundaries too
+        int n = http_read_body(h, buf, sizeof(buf));
+        if (n <= 0) return n;
+        if (*got + (size_t)n < cap)
+        {
+            memcpy(out + *got, buf, (size_t)n);
+            *got += (size_t)n;
+        }
+    }
+}
+
+// Runs resp through the parser at every read size and checks status and body.
+// want_end: expected final read result (0 clean, < 0 error).
+static void expect_body(const char *name, const char *resp, int status, const char *body, int want_end,
+                        http_reply_t *last)
+{
+    for (size_t s = 0; s < sizeof(k_steps) / sizeof(k_steps[0]); s++)
+    {
+        fake_t f = { .data = resp, .len = strlen(resp), .step = k_steps[s] };
+        http_stream_t h;
+        http_reply_t r;
+        http_stream_init(&h, fake_recv, fake_send, &f);
+
+        bool ok = http_read_head(&h, &r);
+        CHECK(ok, "%s/%zu: head not parsed", name, k_steps[s]);
+        if (!ok) continue;
+        CHECK(r.status == status, "%s/%zu: status %d, want %d", name, k_steps[s], r.status, status);
+
+        char out[256];
+        size_t got;
+        int end = drain(&h, out, sizeof(out), &got);
+        out[got] = '\0';
+        CHECK((end < 0) == (want_end < 0), "%s/%zu: body ended with %d, want %d", name, k_steps[s], end, want_end);
+        CHECK(strcmp(out, body) == 0, "%s/%zu: body \"%s\", want \"%s\"", name, k_steps[s], out, body);
+        if (want_end == 0)
+            CHECK(http_read_body(&h, out, sizeof(out)) == 0, "%s/%zu: data after the end", name, k_steps[s]);
+        if (last) *last = r;
+    }
+}
+
+static void test_content_length(void)
+{
+    http_reply_t r;
+    // Bytes past Content-Length (a keep-alive server's next reply) are not body
+    expect_body("content-length",
+                "HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: 11\r\n\r\nhello worldEXTRA",
+                200, "hello world", 0, &r);
+    CHECK(r.content_length == 11, "content-length: %lld", (long long)r.content_length);
+
+    expect_body("content-length-0", "HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", 200, "", 0, NULL);
+    expect_body("short-body", "HTTP/1.1 200 OK\r\nContent-Length: 20\r\n\r\nonly this", 200, "only this", -1, NULL);
+}
+
+static void test_chunked(void)
+{
+    http_reply_t r;
+    expect_body("chunked",
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n"
+                "4\r\nWiki\r\n"
+                "5;name=value\r\npedia\r\n"
+                "E\r\n in\r\n\r\nchunks.\r\n"
+                "0\r\nX-Trailer: ignored\r\n\r\n",
+                200, "Wikipedia in\r\n\r\nchunks.", 0, &r);
+    CHECK(r.content_length == -1, "chunked: content_length %lld", (long long)r.content_length);
+
+    // Transfer-Encoding wins over a Content-Length in either order
+    expect_body("chunked+cl",
+                "HTTP/1.1 200 OK\r\nContent-Length: 3\r\ntransfer-encoding: Chunked\r\n\r\n"
+                "a\r\n0123456789\r\n0\r\n\r\n",
+                200, "0123456789", 0, NULL);
+    expect_body("chunked-upper-hex",
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n1A\r\nabcdefghijklmnopqrstuvwxyz\r\n0\r\n\r\n",
+                200, "abcdefghijklmnopqrstuvwxyz", 0, NULL);
+    expect_body("chunked-cut",
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n8\r\nabc",
+                200, "abc", -1, NULL);
+    expect_body("chunked-bad-size",
+                "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\nabc\r\n",
+                200, "", -1, NULL);
+}
+
+static void test_read_to_close(void)
+{
+    expect_body("read-to-close",
+                "HTTP/1.0 200 OK\r\nServer: test\r\n\r\nuntil the server closes",
+                200, "until the server closes", 0, NULL);
+    expect_body("no-body-204", "HTTP/1.1 204 No Content\r\n\r\nignored", 204, "", 0, NULL);
+    expect_body("no-body-304", "HTTP/1.1 304 Not Modified\r\nContent-Length: 5\r\n\r\n", 304, "", 0, NULL);
+}
+
+static void test_headers(void)
+{
+    http_reply_t r;
+    expect_body("range",
+                "HTTP/1.1 206 Partial Content\r\nContent-Range: bytes 100-199/200\r\nContent-Length: 4\r\n\r\nabcd",
+                206, "abcd", 0, &r);
+    CHECK(strcmp(r.content_range, "bytes 100-199/200") == 0, "range: \"%s\"", r.content_range);
+
+    expect_body("retry-after",
+                "HTTP/1.1 503 Service Unavailable\r\nretry-after:\t120\r\nContent-Length: 4\r\n\r\nbusy",
+                503, "busy", 0, &r);
+    CHECK(strcmp(r.server.retry_after, "120") == 0, "retry-after: \"%s\"", r.server.retry_after);
+    CHECK(r.content_range[0] == '\0', "retry-after: stray content_range \"%s\"", r.content_range);
+}
+
+static void test_redirects(void)
+{
+    http_reply_t r;
+    expect_body("redirect",
+                "HTTP/1.1 302 Found\r\nLocation: https://cdn.example.com/fw.bin\r\nContent-Length: 5\r\n\r\nmoved",
+                302, "moved", 0, &r);
+    CHECK(http_is_redirect(&r), "302 with Location not a redirect");
+    CHECK(strcmp(r.location, "https://cdn.example.com/fw.bin") == 0, "location: \"%s\"", r.location);
+
+    expect_body("redirect-no-location", "HTTP/1.1 301 Moved\r\nContent-Length: 0\r\n\r\n", 301, "", 0, &r);
+    CHECK(!http_is_redirect(&r), "301 without Location followed");
+    expect_body("not-a-redirect", "HTTP/1.1 300 Multiple\r\nLocation: /a\r\nContent-Length: 0\r\n\r\n", 300, "", 0, &r);
+    CHECK(!http_is_redirect(&r), "300 followed");
+
+    // A Location too long to keep whole is dropped, not cut
+    static char resp[OTA_HTTP_URL_MAX + 128];
+    int n = snprintf(resp, sizeof(resp), "HTTP/1.1 307 Temporary\r\nLocation: /");
+    memset(resp + n, 'l', OTA_HTTP_URL_MAX);
+    snprintf(resp + n + OTA_HTTP_URL_MAX, sizeof(resp) - n - OTA_HTTP_URL_MAX, "\r\n\r\n");
+    expect_body("long-location", resp, 307, "", 0, &r);
+    CHECK(!http_is_redirect(&r), "cut Location followed");
+
+    const struct { const char *base, *loc, *want; } cases[] = {
+        { "https://a.example.com/fw/app.bin?v=1", "http://b.example.com/x", "http://b.example.com/x" },
+        { "https://a.example.com/fw/app.bin", "//b.example.com/x", "https://b.example.com/x" },
+        { "https://a.example.com:8443/fw/app.bin", "/other/y.bin", "https://a.example.com:8443/other/y.bin" },
+        { "http://a.example.com/fw/app.bin?v=1", "y.bin?v=2", "http://a.example.com/fw/y.bin?v=2" },
+        { "http://a.example.com/app.bin", "y.bin", "http://a.example.com/y.bin" },
+        { "http://a.example.com", "y.bin", "http://a.example.com/y.bin" },
+        { "http://a.example.com?q=/z", "y.bin", "http://a.example.com/y.bin" },
+    };
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        http_url_t u;
+        char out[OTA_HTTP_URL_MAX];
+        bool ok = http_parse_url(cases[i].base, &u) && http_resolve_location(&u, cases[i].loc, out, sizeof(out));
+        CHECK(ok && strcmp(out, cases[i].want) == 0, "resolve %s + %s: \"%s\", want \"%s\"",
+              cases[i].base, cases[i].loc, ok ? out : "(failed)", cases[i].want);
+    }
+
+    http_url_t u;
+    char small[24];
+    CHECK(http_parse_url("https://a.example.com/", &u) &&
+          !http_resolve_location(&u, "/a/rather/long/path.bin", small, sizeof(small)), "overflow resolved");
+}
+
+static void test_bad_heads(void)
+{
+    const char *bad[] = {
+        "",                                             // closed before any byte
+        "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n",     // closed inside the head
+        "SSH-2.0-OpenSSH\r\n\r\n",                      // not HTTP
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++)
+    {
+        fake_t f = { .data = bad[i], .len = strlen(bad[i]), .step = 4096 };
+        http_stream_t h;
+        http_reply_t r;
+        http_stream_init(&h, fake_recv, fake_send, &f);
+        CHECK(!http_read_head(&h, &r), "bad head %zu accepted", i);
+    }
+
+    // A head that can't fit OTA_HTTP_RX_BUF_SIZE
+    static char big[OTA_HTTP_RX_BUF_SIZE + 64];
+    int n = snprintf(big, sizeof(big), "HTTP/1.1 200 OK\r\nX-Pad: ");
+    memset(big + n, 'x', sizeof(big) - (size_t)n - 1);
+    big[sizeof(big) - 1] = '\0';
+    fake_t f = { .data = big, .len = strlen(big), .step = 4096 };
+    http_stream_t h;
+    http_reply_t r;
+    http_stream_init(&h, fake_recv, fake_send, &f);
+    CHECK(!http_read_head(&h, &r), "oversized head accepted");
+}
+
+static void test_request(void)
+{
+    http_url_t u;
+    fake_t f = { .step = 4096 };
+    http_stream_t h;
+    http_stream_init(&h, fake_recv, fake_send, &f);
+
+    CHECK(http_parse_url("https://ota.example.com/fw/app.bin?v=2", &u), "parse https");
+    CHECK(u.tls && strcmp(u.host, "ota.example.com") == 0 && strcmp(u.port, "443") == 0 &&
+          strcmp(u.path, "/fw/app.bin?v=2") == 0, "https parts %s %s %s", u.host, u.port, u.path);
+    CHECK(http_send_get(&h, &u, 0), "send");
+    CHECK(strstr(f.sent, "GET /fw/app.bin?v=2 HTTP/1.1\r\nHost: ota.example.com\r\n") == f.sent,
+          "request line/host:\n%s", f.sent);
+    CHECK(!strstr(f.sent, "Range:"), "range without offset:\n%s", f.sent);
+    CHECK(strlen(f.sent) > 4 && strcmp(f.sent + strlen(f.sent) - 4, "\r\n\r\n") == 0, "head not terminated");
+
+    CHECK(http_parse_url("http://10.0.0.2:8080", &u), "parse http with port");
+    CHECK(!u.tls && strcmp(u.port, "8080") == 0 && u.path[0] == '\0', "http parts %s %s", u.port, u.path);
+    CHECK(http_send_get(&h, &u, 4096), "send range");
+    CHECK(strstr(f.sent, "GET / HTTP/1.1\r\n") == f.sent, "empty path:\n%s", f.sent);
+    CHECK(strstr(f.sent, "\r\nHost: 10.0.0.2:8080\r\n") != NULL, "host with port:\n%s", f.sent);
+    CHECK(strstr(f.sent, "\r\nRange: bytes=4096-\r\n") != NULL, "range header:\n%s", f.sent);
+
+    CHECK(http_parse_url("https://h?q=1", &u) && strcmp(u.path, "?q=1") == 0, "query only");
+    CHECK(http_send_get(&h, &u, 0) && strstr(f.sent, "GET /?q=1 HTTP/1.1\r\n") == f.sent, "query path:\n%s", f.sent);
+
+    CHECK(!http_parse_url("ftp://h/x", &u), "ftp accepted");
+    CHECK(!http_parse_url("https:///x", &u), "empty host accepted");
+    CHECK(!http_parse_url("https://h:/x", &u), "empty port accepted");
+    CHECK(!http_parse_url("https://h:123456789/x", &u), "long port accepted");
+
+    // Request bigger than OTA_HTTP_TX_BUF_SIZE
+    static char url[OTA_HTTP_TX_BUF_SIZE + 32];
+    int n = snprintf(url, sizeof(url), "https://h/");
+    memset(url + n, 'p', sizeof(url) - (size_t)n - 1);
+    url[sizeof(url) - 1] = '\0';
+    CHECK(http_parse_url(url, &u) && !http_send_get(&h, &u, 0), "oversized request sent");
+}
+
+int main(void)
+{
+    test_content_length();
+    test_chunked();
+    test_read_to_close();
+    test_headers();
+    test_redirects();
+    test_bad_heads();
+    test_request();
+
+    printf("%d passed, %d failed\n", s_passed, s_failed);
+    return s_failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,151 @@
+#!/usr/bin/env python3
+"""Decode the tracepoint ring kept in RTC memory (storage/trace.c).
+
+Input is either the raw ring from the device's metrics server:
+
+    curl -s http://<device-ip>:9100/trace -o trace.bin
+    python3 tools/trace_decode.py trace.bin
+
+or a serial log containing the "TRACE <offset> <hex>" lines printed at
+boot with TRACE_DUMP_AT_BOOT:
+
+    python3 tools/trace_decode.py monitor.log
+
+Event names and argument names come from storage/trace_ids.h and state
+names from ota/ota_states.h, so the tool follows the firmware it ships with.
+"""
+
+import os
+import re
+import struct
+import sys
+
+ROOT = os.path.dirname(os.path.dirname(os.path.abspath(__file__)))
+IDS_H = os.path.join(ROOT, "storage", "trace_ids.h")
+STATES_H = os.path.join(ROOT, "ota", "ota_states.h")
+
+MAGIC = 0x54524331
+VERSION = 2
+CORE1 = 0x8000                     # id bit: record written on core 1
+HDR = struct.Struct("<IHHII")      # magic, version, ring_len, head, boot_seq
+REC = struct.Struct("<IHHII")      # cycles, id, seq, a, b
+
+RESET_REASONS = ["UNKNOWN", "POWERON", "EXT", "SW", "PANIC", "INT_WDT",
+                 "TASK_WDT", "WDT", "DEEPSLEEP", "BROWNOUT", "SDIO"]
+
+
+def load_events():
+    events = {}
+    pat = re.compile(r'X\((\w+),\s*(0x[0-9a-fA-F]+),\s*"([^"]*)",\s*"([^"]*)"\)')
+    with open(IDS_H) as f:
+        for m in pat.finditer(f.read()):
+            events[int(m.group(2), 16)] = (m.group(1), m.group(3), m.group(4))
+    return events
+
+
+def load_states():
+    with open(STATES_H) as f:
+        body = re.search(r"enum\s*\{(.*?)\}", f.read(), re.S).group(1)
+    return [re.match(r"\s*OTA_STATE_(\w+)", s).group(1)
+            for s in body.split(",") if s.strip()]
+
+
+def read_input(path):
+    with open(path, "rb") as f:
+        data = f.read()
+    if len(data) >= 4 and struct.unpack_from("<I", data)[0] == MAGIC:
+        return data
+
+    # Serial log: reassemble the hex dump (last dump wins if there are several)
+    chunks = {}
+    for line in data.decode("utf-8", "replace").splitlines():
+        m = re.search(r"TRACE ([0-9a-f]{4}) ([0-9a-f]+)", line)
+        if m:
+            off = int(m.group(1), 16)
+            if off == 0:
+                chunks = {}
+            chunks[off] = bytes.fromhex(m.group(2))
+    out = bytearray()
+    for off in sorted(chunks):
+        out[off:off + len(chunks[off])] = chunks[off]
+    return bytes(out)
+
+
+def records(data):
+    magic, version, ring_len, head, boot_seq = HDR.unpack_from(data)
+    if magic != MAGIC or version != VERSION:
+        sys.exit("not a trace ring (magic %08x, version %d)" % (magic, version))
+
+    base = HDR.size
+    out = []
+    for idx in range(max(0, head - ring_len), head):
+        cycles, ev, seq, a, b = REC.unpack_from(data, base + (idx % ring_len) * REC.size)
+        if seq != idx & 0xFFFF:
+            continue    # overwritten or torn mid-write
+        out.append((idx, cycles, ev & ~CORE1, a, b, 1 if ev & CORE1 else 0))
+    return out, boot_seq
+
+
+def timestamps(recs, events):
+    """ms since boot for each record, anchored on the nearest TR_SYNC
+    written by the same core (each core has its own CCOUNT)."""
+    sync_id = next(k for k, v in events.items() if v[0] == "TR_SYNC")
+    boot_id = next(k for k, v in events.items() if v[0] == "TR_BOOT")
+
+    times = [None] * len(recs)
+    anchor = {}         # core -> (cycles, ms, ticks_per_us)
+    pending = {}        # core -> records before that core's first sync of a boot
+
+    def place(i, anc):
+        cyc, ms, tpu = anc
+        delta = (recs[i][1] - cyc + 2**31) % 2**32 - 2**31    # nearest wrap
+        times[i] = ms + delta / (tpu * 1000.0)
+
+    for i, (_, cycles, ev, a, b, core) in enumerate(recs):
+        if ev == boot_id:
+            anchor = {}
+            pending = {}
+        if ev == sync_id and b:         # b == 0: benchmark filler
+            anchor[core] = (cycles, a, b)
+            for j in pending.pop(core, []):
+                place(j, anchor[core])
+        if core in anchor:
+            place(i, anchor[core])
+        else:
+            pending.setdefault(core, []).append(i)
+    return times
+
+
+def fmt_args(name, argn, a, b, states):
+    if name == "TR_STATE":
+        def st(v):
+            return states[v] if v < len(states) else str(v)
+        return "%s -> %s" % (st(a), st(b))
+    if name == "TR_BOOT":
+        rr = RESET_REASONS[a] if a < len(RESET_REASONS) else str(a)
+        return "reset=%s boot_seq=%d" % (rr, b)
+    return "%s=%d %s=%d" % (argn[0], a, argn[1], b)
+
+
+def main():
+    if len(sys.argv) != 2:
+        sys.exit(__doc__)
+
+    events = load_events()
+    states = load_states()
+    recs, boot_seq = records(read_input(sys.argv[1]))
+    times = timestamps(recs, events)
+
+    boot = boot_seq - sum(1 for r in recs if events.get(r[2], ("",))[0] == "TR_BOOT")
+    print("%d records, ring boot_seq %d" % (len(recs), boot_seq))
+    for (idx, _, ev, a, b, core), t in zip(recs, times):
+        name, an, bn = events.get(ev, ("0x%04x" % ev, "a", "b"))
+        if name == "TR_BOOT":
+            boot = b
+            print("---- boot %d ----" % b)
+        ts = "%10.3f" % t if t is not None else "         ?"
+        print("%8d  b%-3d c%d %s ms  %-15s %s" % (idx, boot, core, ts, name, fmt_args(name, (an, bn), a, b, states)))
+
+
+if __name__ == "__main__":
+    main()
@@ -1,11 +1,57 @@
 #include "buzzer.h"
 #include "config/pin_config.h"
+#include "config/ui_config.h"
 #include "driver/gpio.h"
 #include "freertos/FreeRTOS.h"
-#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include <string.h>
 
 #define BEEP_ON_MS   200
 #define BEEP_OFF_MS  200
+#define BEEP_LONG_MS 800
+
+static const char *TAG = "buzzer";
+
+// Player state, shared between callers and the esp_timer callback
+static portMUX_TYPE s_mux = portMUX_INITIALIZER_UNLOCKED;
+static esp_timer_handle_t s_timer = NULL;
+static buzzer_pattern_t s_queue[BUZZER_QUEUE_LEN];
+static int s_head = 0;
+static int s_count = 0;
+static bool s_playing = false;
+static uint8_t s_step = 0;          // index into s_queue[s_head].ms
+
+// Start the next step, or the next queued pattern. Call with s_mux held;
+// returns the level to drive and sets *ms_out (0 = nothing left).
+static int advance_locked(uint32_t *ms_out) {
+    while (s_count > 0) {
+        const buzzer_pattern_t *p = &s_queue[s_head];
+        if (s_step < p->count) {
+            *ms_out = p->ms[s_step];
+            return (s_step++ & 1) ? 0 : 1;
+        }
+        s_head = (s_head + 1) % BUZZER_QUEUE_LEN;
+        s_count--;
+        s_step = 0;
+    }
+    *ms_out = 0;
+    s_playing = false;
+    return 0;
+}
+
+static void step_cb(void *arg) {
+    uint32_t ms;
+
+    portENTER_CRITICAL(&s_mux);
+    int level = advance_locked(&ms);
+    portEXIT_CRITICAL(&s_mux);
+
+    gpio_set_level(BUZZER_PIN, level);
+    if (ms > 0) {
+        esp_timer_start_once(s_timer, (uint64_t)ms * 1000);
+    }
+}
 
 void buzzer_init(void) {
     gpio_config_t cfg = {
@@ -14,13 +60,99 @@ void buzzer_init(void) {
     };
     gpio_config(&cfg);
     gpio_set_level(BUZZER_PIN, 0);
+
+    const esp_timer_create_args_t args = {
+        .callback = step_cb,
+        .name = "buzzer"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&args, &s_timer));
 }
 
-void buzzer_beep(uint8_t count) {
-    for (uint8_t i = 0; i < count; i++) {
-        gpio_set_level(BUZZER_PIN, 1);
-        vTaskDelay(pdMS_TO_TICKS(BEEP_ON_MS));
-        gpio_set_level(BUZZER_PIN, 0);
-        vTaskDelay(pdMS_TO_TICKS(BEEP_OFF_MS));
+void buzzer_play(const buzzer_pattern_t *p, bool override) {
+    if (!p || p->count == 0 || !s_timer) {
+        return;
+    }
+
+    bool start = false;
+    bool dropped = false;
+
+    portENTER_CRITICAL(&s_mux);
+    if (override) {
+        s_head = 0;
+        s_count = 0;
+        s_step = 0;
+        s_playing = false;
+    }
+    if (s_count < BUZZER_QUEUE_LEN) {
+        buzzer_pattern_t *slot = &s_queue[(s_head + s_count) % BUZZER_QUEUE_LEN];
+        *slot = *p;
+        if (slot->count > BUZZER_MAX_STEPS) {
+            slot->count = BUZZER_MAX_STEPS;
+        }
+        s_count++;
+    } else {
+        dropped = true;
+    }
+    if (!s_playing && s_count > 0) {
+        s_playing = true;
+        start = true;
+    }
+    portEXIT_CRITICAL(&s_mux);
+
+    if (dropped) {
+        ESP_LOGW(TAG, "queue full, pattern dropped");
     }
+    if (start) {
+        // Kick the player from the timer task so all GPIO writes come from there
+        esp_timer_stop(s_timer);
+        esp_timer_start_once(s_timer, 0);
+    }
+}
+
+void buzzer_stop(void) {
+    portENTER_CRITICAL(&s_mux);
+    s_head = 0;
+    s_count = 0;
+    s_step = 0;
+    s_playing = false;
+    portEXIT_CRITICAL(&s_mux);
+
+    if (s_timer) {
+        esp_timer_stop(s_timer);
+    }
+    gpio_set_level(BUZZER_PIN, 0);
+}
+
+static void pattern_beeps(buzzer_pattern_t *p, uint16_t first_on, uint8_t count) {
+    memset(p, 0, sizeof(*p));
+    if (first_on) {
+        p->ms[p->count++] = first_on;
+        p->ms[p->count++] = BEEP_OFF_MS * 2;
+    }
+    for (uint8_t i = 0; i < count && p->count + 2 <= BUZZER_MAX_STEPS; i++) {
+        p->ms[p->count++] = BEEP_ON_MS;
+        p->ms[p->count++] = BEEP_OFF_MS;
+    }
+}
+
+void buzzer_beep(uint8_t count) {
+    buzzer_pattern_t p;
+    pattern_beeps(&p, 0, count);
+    buzzer_play(&p, false);
+}
+
+void buzzer_success(void) {
+    static const buzzer_pattern_t p = { .ms = { 80, 80, 80, 200 }, .count = 4 };
+    buzzer_play(&p, true);
+}
+
+void buzzer_failure(void) {
+    static const buzzer_pattern_t p = { .ms = { BEEP_LONG_MS, BEEP_OFF_MS }, .count = 2 };
+    buzzer_play(&p, true);
+}
+
+void buzzer_error_code(uint8_t cls) {
+    buzzer_pattern_t p;
+    pattern_beeps(&p, BEEP_LONG_MS, cls);
+    buzzer_play(&p, true);
 }
@@ -1,9 +1,27 @@
 #ifndef BUZZER_H
 #define BUZZER_H
 
+#include <stdbool.h>
 #include <stdint.h>
 
+#define BUZZER_MAX_STEPS  16
+
+// Alternating on/off durations in ms, starting with "on"
+typedef struct {
+    uint16_t ms[BUZZER_MAX_STEPS];
+    uint8_t count;
+} buzzer_pattern_t;
+
 void buzzer_init(void);
-void buzzer_beep(uint8_t count);
+
+// All calls return immediately. Queued patterns play after the current
+// one; override cuts the current one and drops anything queued.
+void buzzer_play(const buzzer_pattern_t *p, bool override);
+void buzzer_stop(void);
+
+void buzzer_beep(uint8_t count);        // short beeps, queued
+void buzzer_success(void);              // two quick beeps
+void buzzer_failure(void);              // one long beep
+void buzzer_error_code(uint8_t cls);    // long beep, then cls short beeps
 
 #endif
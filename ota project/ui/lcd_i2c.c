@@ -1,7 +1,9 @@
 #include "lcd_i2c.h"
 #include "config/pin_config.h"
+#include "config/ui_config.h"
 
 #include "driver/i2c.h"
+#include "esp_rom_sys.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include <stdio.h>
@@ -10,46 +12,73 @@
 #define LCD_ENABLE     0x04
 #define LCD_RS         0x01
 
-static void lcd_i2c_write(uint8_t data)
+// Clear and home run for 1.52 ms; everything else finishes in ~40 us,
+// which the I2C bytes that follow already cover at 100 kHz
+#define LCD_SLOW_CMD_US  2000
+
+// At 400 kHz two I2C bytes (~45 us) are too close to the 37-41 us
+// execution time, so each byte is held for one extra frame
+#if I2C_MASTER_FREQ_HZ > 100000
+#define LCD_HOLD_FRAMES  1
+#else
+#define LCD_HOLD_FRAMES  0
+#endif
+
+#define LCD_FRAMES_PER_BYTE  (4 + LCD_HOLD_FRAMES)
+
+// Expander frames queued for the next transaction. Not reentrant: all
+// display calls come from one task.
+static uint8_t s_tx[LCD_I2C_BATCH_BYTES];
+static size_t s_tx_len = 0;
+
+static void lcd_flush(void)
 {
+    if (s_tx_len == 0) return;
+
     i2c_master_write_to_device(
         I2C_MASTER_NUM,
         LCD_I2C_ADDR,
-        &data,
-        1,
-        pdMS_TO_TICKS(100)
+        s_tx,
+        s_tx_len,
+        pdMS_TO_TICKS(LCD_I2C_TIMEOUT_MS)
     );
+    s_tx_len = 0;
 }
 
-static void lcd_pulse_enable(uint8_t data)
-{
-    lcd_i2c_write(data | LCD_ENABLE | LCD_BACKLIGHT);
-    vTaskDelay(pdMS_TO_TICKS(1));
-    lcd_i2c_write((data & ~LCD_ENABLE) | LCD_BACKLIGHT);
-    vTaskDelay(pdMS_TO_TICKS(1));
-}
-
-static void lcd_send_nibble(uint8_t nibble, uint8_t rs)
+// EN high then low: the controller latches the nibble on the falling edge.
+// The PCF8574 needs no delay between frames, one I2C byte is ~90 us.
+static void lcd_queue_nibble(uint8_t nibble, uint8_t rs)
 {
     uint8_t data = (nibble << 4) | rs | LCD_BACKLIGHT;
-    lcd_pulse_enable(data);
+    s_tx[s_tx_len++] = data | LCD_ENABLE;
+    s_tx[s_tx_len++] = data;
 }
 
-static void lcd_send_byte(uint8_t byte, uint8_t rs)
+static void lcd_queue_byte(uint8_t byte, uint8_t rs)
 {
-    lcd_send_nibble(byte >> 4, rs);
-    lcd_send_nibble(byte & 0x0F, rs);
+    if (s_tx_len + LCD_FRAMES_PER_BYTE > sizeof(s_tx)) lcd_flush();
+
+    lcd_queue_nibble(byte >> 4, rs);
+    lcd_queue_nibble(byte & 0x0F, rs);
+    for (int i = 0; i < LCD_HOLD_FRAMES; i++)
+    {
+        s_tx[s_tx_len] = s_tx[s_tx_len - 1];
+        s_tx_len++;
+    }
 }
 
 static void lcd_cmd(uint8_t cmd)
 {
-    lcd_send_byte(cmd, 0);
-    vTaskDelay(pdMS_TO_TICKS(2));
+    lcd_queue_byte(cmd, 0);
+    lcd_flush();
+
+    if (cmd <= 0x03) esp_rom_delay_us(LCD_SLOW_CMD_US);    // clear / home
 }
 
-static void lcd_data(uint8_t data)
+static uint8_t lcd_ddram_addr(uint8_t row, uint8_t col)
 {
-    lcd_send_byte(data, LCD_RS);
+    static const uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
+    return 0x80 | (col + row_offsets[row & 3]);
 }
 
 void lcd_hw_init(void)
@@ -68,13 +97,15 @@ void lcd_hw_init(void)
 
     vTaskDelay(pdMS_TO_TICKS(50));
 
-    lcd_send_nibble(0x03, 0);
-    vTaskDelay(pdMS_TO_TICKS(5));
-    lcd_send_nibble(0x03, 0);
-    vTaskDelay(pdMS_TO_TICKS(5));
-    lcd_send_nibble(0x03, 0);
-    vTaskDelay(pdMS_TO_TICKS(5));
-    lcd_send_nibble(0x02, 0);  // 4-bit mode
+    // Reset sequence needs ms gaps; once at boot, so sleep rather than spin
+    for (int i = 0; i < 3; i++)
+    {
+        lcd_queue_nibble(0x03, 0);
+        lcd_flush();
+        vTaskDelay(pdMS_TO_TICKS(5));
+    }
+    lcd_queue_nibble(0x02, 0);  // 4-bit mode
+    lcd_flush();
 
     lcd_cmd(0x28); // 4-bit, 2-line
     lcd_cmd(0x0C); // Display ON
@@ -89,14 +120,86 @@ void lcd_hw_clear(void)
 
 void lcd_hw_set_cursor(uint8_t row, uint8_t col)
 {
-    uint8_t row_offsets[] = {0x00, 0x40, 0x14, 0x54};
-    lcd_cmd(0x80 | (col + row_offsets[row]));
+    lcd_cmd(lcd_ddram_addr(row, col));
 }
 
 void lcd_hw_print(const char *str)
 {
     while (*str)
     {
-        lcd_data(*str++);
+        lcd_queue_byte((uint8_t)*str++, LCD_RS);
+    }
+    lcd_flush();
+}
+
+void lcd_hw_write_at(uint8_t row, uint8_t col, const char *str)
+{
+    lcd_queue_byte(lcd_ddram_addr(row, col), 0);
+    while (*str)
+    {
+        lcd_queue_byte((uint8_t)*str++, LCD_RS);
+    }
+    lcd_flush();
+}
+
+#if LCD_I2C_BENCH
+#include "esp_log.h"
+#include "esp_timer.h"
+
+static const char *TAG = "lcd_bench";
+
+// Previous transport: two transactions and two tick delays per nibble
+static void bench_legacy_write(uint8_t data)
+{
+    i2c_master_write_to_device(I2C_MASTER_NUM, LCD_I2C_ADDR, &data, 1, pdMS_TO_TICKS(100));
+}
+
+static void bench_legacy_byte(uint8_t byte, uint8_t rs)
+{
+    uint8_t nib[2] = { byte >> 4, byte & 0x0F };
+    for (int i = 0; i < 2; i++)
+    {
+        uint8_t data = (nib[i] << 4) | rs | LCD_BACKLIGHT;
+        bench_legacy_write(data | LCD_ENABLE);
+        vTaskDelay(pdMS_TO_TICKS(1));
+        bench_legacy_write(data);
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+}
+
+static void bench_legacy_screen(const char *line)
+{
+    for (uint8_t r = 0; r < 4; r++)
+    {
+        bench_legacy_byte(lcd_ddram_addr(r, 0), 0);
+        vTaskDelay(pdMS_TO_TICKS(2));
+        for (const char *p = line; *p; p++) bench_legacy_byte((uint8_t)*p, LCD_RS);
     }
 }
+
+static void bench_batched_screen(const char *line)
+{
+    for (uint8_t r = 0; r < 4; r++) lcd_hw_write_at(r, 0, line);
+}
+
+static void bench_run(const char *name, void (*screen)(const char *), int rounds)
+{
+    static const char *lines[2] = { "0123456789ABCDEFGHIJ", "abcdefghijklmnopqrst" };
+
+    int64_t t0 = esp_timer_get_time();
+    for (int i = 0; i < rounds; i++) screen(lines[i & 1]);
+    int64_t us = esp_timer_get_time() - t0;
+
+    int chars = rounds * 80;
+    ESP_LOGI(TAG, "%-8s %d chars in %lld us -> %lld chars/s",
+             name, chars, (long long)us, us > 0 ? (long long)chars * 1000000 / us : 0);
+}
+
+void lcd_hw_benchmark(void)
+{
+    ESP_LOGI(TAG, "I2C %d Hz, %d-byte batches", I2C_MASTER_FREQ_HZ, LCD_I2C_BATCH_BYTES);
+    bench_run("legacy", bench_legacy_screen, 4);
+    bench_run("batched", bench_batched_screen, 40);
+    lcd_hw_clear();
+}
+#endif
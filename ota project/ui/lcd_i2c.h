@@ -8,4 +8,11 @@ void lcd_hw_clear(void);
 void lcd_hw_set_cursor(uint8_t row, uint8_t col);
 void lcd_hw_print(const char *str);
 
+// Cursor move and text in a single I2C transaction
+void lcd_hw_write_at(uint8_t row, uint8_t col, const char *str);
+
+// Characters/second of the old per-nibble transport vs. batched writes
+// (only with LCD_I2C_BENCH)
+void lcd_hw_benchmark(void);
+
 #endif
@@ -1,22 +1,74 @@
 #include "lcd_ui.h"
+#include "lcd_i2c.h"
+#include "config/ui_config.h"
+#include "storage/mem_monitor.h"
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
 #include <string.h>
 #include <stdio.h>
+#include <stdbool.h>
 
-// These must exist in LCD driver (To be renamed if different)
-extern void lcd_clear(void);
-extern void lcd_set_cursor(int col, int row);
-extern void lcd_print(const char *s);
+#define LCD_COLS  20
+#define LCD_ROWS  4
 
-void lcd_init(void)
+// Unchanged cells this short between two changes are rewritten instead of
+// paying for a cursor command
+#define LCD_MERGE_GAP  2
+
+static const char *TAG = "lcd_ui";
+
+typedef struct {
+    char cell[LCD_ROWS][LCD_COLS];
+} lcd_frame_t;
+
+typedef struct {
+    lcd_frame_t frame;
+    uint32_t hold_ms;
+} lcd_timed_t;
+
+// Shadow of what the display currently shows (UI task only). Updates only
+// send the cells that differ; identical frames send nothing.
+static lcd_frame_t s_shadow;
+static bool s_shadow_valid = false;
+
+// Pending work, filled by callers under s_ui_mux. The latest frame is a
+// single slot, so repeated progress updates coalesce; timed messages queue.
+static portMUX_TYPE s_ui_mux = portMUX_INITIALIZER_UNLOCKED;
+static lcd_frame_t s_latest;
+static bool s_latest_dirty = false;
+static lcd_timed_t s_timed[LCD_UI_TIMED_MAX];
+static int s_timed_head = 0;
+static int s_timed_count = 0;
+static TaskHandle_t s_ui_task = NULL;
+
+/* ---------- Frames ---------- */
+
+static void frame_clear(lcd_frame_t *f)
 {
-    lcd_clear();
+    memset(f->cell, ' ', sizeof(f->cell));
 }
 
-void lcd_show_message(const char *msg)
+static void frame_put(lcd_frame_t *f, int row, const char *s)
 {
-    lcd_clear();
-    lcd_set_cursor(0, 0);
-    lcd_print(msg ? msg : "");
+    if (row < 0 || row >= LCD_ROWS || !s) return;
+    for (int c = 0; c < LCD_COLS && s[c]; c++) f->cell[row][c] = s[c];
+}
+
+static void frame_message(lcd_frame_t *f, const char *msg)
+{
+    frame_clear(f);
+
+    // Long messages continue on the next rows
+    const char *p = msg ? msg : "";
+    for (int r = 0; r < LCD_ROWS && *p; r++)
+    {
+        frame_put(f, r, p);
+        size_t len = strlen(p);
+        p += (len < LCD_COLS) ? len : LCD_COLS;
+    }
 }
 
 static void build_bar(int percent, char out[21])
@@ -31,28 +83,174 @@ static void build_bar(int percent, char out[21])
     out[20] = '\0';
 }
 
+/* ---------- Display (UI task) ---------- */
+
+static bool cell_dirty(const lcd_frame_t *f, int r, int c)
+{
+    return !s_shadow_valid || f->cell[r][c] != s_shadow.cell[r][c];
+}
+
+// Send only the cells that differ from the shadow: one cursor move plus
+// the characters for each run of changes
+static void lcd_commit(const lcd_frame_t *f)
+{
+    if (s_shadow_valid && memcmp(f, &s_shadow, sizeof(s_shadow)) == 0) return;
+
+    char run[LCD_COLS + 1];
+
+    for (int r = 0; r < LCD_ROWS; r++)
+    {
+        int c = 0;
+        while (c < LCD_COLS)
+        {
+            if (!cell_dirty(f, r, c)) { c++; continue; }
+
+            // Grow the run until the clean gap after the last change gets too long
+            int start = c;
+            int last = c;
+            for (int k = c + 1; k < LCD_COLS && k - last <= LCD_MERGE_GAP + 1; k++)
+            {
+                if (cell_dirty(f, r, k)) last = k;
+            }
+
+            int n = last - start + 1;
+            memcpy(run, &f->cell[r][start], (size_t)n);
+            run[n] = '\0';
+
+            lcd_hw_write_at((uint8_t)r, (uint8_t)start, run);
+
+            c = last + 1;
+        }
+    }
+
+    s_shadow = *f;
+    s_shadow_valid = true;
+}
+
+static void lcd_ui_task(void *arg)
+{
+    mem_monitor_task_enter(LCD_UI_TASK_STACK);
+    lcd_hw_init();      // ends with a clear: display is all blanks
+#if LCD_I2C_BENCH
+    lcd_hw_benchmark(); // leaves the display cleared as well
+#endif
+    frame_clear(&s_shadow);
+    s_shadow_valid = true;
+
+    lcd_frame_t f;
+    int64_t hold_until_us = 0;
+
+    while (1)
+    {
+        // Sleep until a caller posts something or the current timed message expires
+        TickType_t wait = portMAX_DELAY;
+        int64_t now = esp_timer_get_time();
+        if (hold_until_us > now)
+        {
+            wait = pdMS_TO_TICKS((hold_until_us - now + 999) / 1000);
+            if (wait == 0) wait = 1;
+        }
+        ulTaskNotifyTake(pdTRUE, wait);
+
+        now = esp_timer_get_time();
+        if (hold_until_us > now) continue;
+
+        bool show = false;
+        portENTER_CRITICAL(&s_ui_mux);
+        if (s_timed_count > 0)
+        {
+            f = s_timed[s_timed_head].frame;
+            hold_until_us = now + (int64_t)s_timed[s_timed_head].hold_ms * 1000;
+            s_timed_head = (s_timed_head + 1) % LCD_UI_TIMED_MAX;
+            s_timed_count--;
+            s_latest_dirty = true;      // restore it once the hold ends
+            show = true;
+        }
+        else if (s_latest_dirty)
+        {
+            f = s_latest;
+            s_latest_dirty = false;
+            show = true;
+        }
+        portEXIT_CRITICAL(&s_ui_mux);
+
+        if (show) lcd_commit(&f);
+    }
+}
+
+/* ---------- Public API (any task, never blocks on I2C) ---------- */
+
+static void post_latest(const lcd_frame_t *f)
+{
+    bool changed;
+
+    portENTER_CRITICAL(&s_ui_mux);
+    changed = memcmp(f, &s_latest, sizeof(s_latest)) != 0;
+    if (changed)
+    {
+        s_latest = *f;
+        s_latest_dirty = true;
+    }
+    portEXIT_CRITICAL(&s_ui_mux);
+
+    if (changed && s_ui_task) xTaskNotifyGive(s_ui_task);
+}
+
+void lcd_init(void)
+{
+    if (s_ui_task) return;
+
+    frame_clear(&s_latest);
+    if (xTaskCreate(lcd_ui_task, "lcd_ui", LCD_UI_TASK_STACK, NULL, LCD_UI_TASK_PRIO, &s_ui_task) != pdPASS)
+    {
+        ESP_LOGE(TAG, "UI task create failed");
+        s_ui_task = NULL;
+    }
+}
+
+void lcd_show_message(const char *msg)
+{
+    lcd_frame_t f;
+    frame_message(&f, msg);
+    post_latest(&f);
+}
+
+void lcd_show_message_for(const char *msg, uint32_t ms)
+{
+    lcd_timed_t t;
+    frame_message(&t.frame, msg);
+    t.hold_ms = ms;
+
+    bool queued = false;
+    portENTER_CRITICAL(&s_ui_mux);
+    if (s_timed_count < LCD_UI_TIMED_MAX)
+    {
+        s_timed[(s_timed_head + s_timed_count) % LCD_UI_TIMED_MAX] = t;
+        s_timed_count++;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&s_ui_mux);
+
+    if (!queued) ESP_LOGW(TAG, "timed message dropped: %s", msg ? msg : "");
+    else if (s_ui_task) xTaskNotifyGive(s_ui_task);
+}
+
 void lcd_show_progress_bar(int percent, const char *label)
 {
     char bar[21];
     char line0[21];
     char line1[21];
+    lcd_frame_t f;
 
     build_bar(percent, bar);
 
     snprintf(line0, sizeof(line0), "%s", (label && label[0]) ? label : "Downloading");
     snprintf(line1, sizeof(line1), "%3d%%", percent);
 
-    lcd_clear();
-
-    // Row 0: label
-    lcd_set_cursor(0, 0);
-    lcd_print(line0);
-
-    // Row 1: bar
-    lcd_set_cursor(0, 1);
-    lcd_print(bar);
+    frame_clear(&f);
+    frame_put(&f, 0, line0);    // Row 0: label
+    frame_put(&f, 1, bar);      // Row 1: bar
+    frame_put(&f, 2, line1);    // Row 2: percent text
 
-    // Row 2: percent text
-    lcd_set_cursor(0, 2);
-    lcd_print(line1);
+    post_latest(&f);
 }
@@ -1,9 +1,15 @@
 #ifndef LCD_UI_H
 #define LCD_UI_H
 
+#include <stdint.h>
+
+// Starts the UI task; display calls below only post to it and return
 void lcd_init(void);
 void lcd_show_message(const char *msg);
 
+// Shown for ms before the next timed message or the latest regular one
+void lcd_show_message_for(const char *msg, uint32_t ms);
+
 // Step 10 additions
 void lcd_show_progress_bar(int percent, const char *label); // label can be NULL
 